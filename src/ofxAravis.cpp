@@ -17,64 +17,101 @@ namespace ofxAravis {
 	void Grabber::setBufferCallback(BufferCallback callback) {
 		bufferCallback = callback;
 	}
-	void Grabber::onNewBuffer(ArvStream *stream, Grabber *aravis) {
-		ArvBuffer *buffer;
-		
-		buffer = arv_stream_try_pop_buffer(stream);
-		if (buffer != nullptr) {
-			if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS) {
-				auto w = arv_buffer_get_image_width(buffer);
-				auto h = arv_buffer_get_image_height(buffer);
-				auto format = arv_buffer_get_image_pixel_format(buffer);
-				
-//                ofLog() << "FORMAT" << format;
-				
-				cv::Mat matRgb(h, w, CV_8UC3);
-				
-//                if (!formatIsFound) {
-					// DO THIS
-					// for loop over all ARV_PIXEL_FORMATS
-					// if (format == ARV_PIXEL_FORMAT_XXXX) ofLog() << "ARV FORMAT" << nameOfARVPixelFormat;
-				
-//                }
-				switch (format) {
-					case ARV_PIXEL_FORMAT_BAYER_RG_8: {
-						cv::Mat matBayer(h, w, CV_8UC1, const_cast<void *>(arv_buffer_get_data(buffer, nullptr)));
-						cv::cvtColor(matBayer, matRgb, CV_BayerRG2BGR);
-					}
-						break;
-
-					case ARV_PIXEL_FORMAT_BAYER_GB_8: {
-						cv::Mat matBayer(h, w, CV_8UC1, const_cast<void *>(arv_buffer_get_data(buffer, nullptr)));
-						cv::cvtColor(matBayer, matRgb, CV_BayerGB2BGR);
-					}
-						break;
-
-					default:
-						ofLogError("ofxAravis") << "Unknown pixel format";
-				}
-
-				aravis->setPixels(matRgb);
-				
-				if (aravis->bufferCallback) aravis->bufferCallback(matRgb);
-			}
+	void Grabber::setFrameCallback(FrameCallback callback) {
+		frameCallback = callback;
+	}
+	void Grabber::onNewBuffer(ArvStream *stream, ArvBuffer *buffer) {
+		
+		ArvBufferStatus status = arv_buffer_get_status(buffer);
+		stats.bufferStatus(status);
+		if (status != ARV_BUFFER_STATUS_SUCCESS) {
 			arv_stream_push_buffer(stream, buffer);
+			return;
+		}
+		stats.frameArrived();
+		watchdog.frameArrived();
+		
+		// the camera buffer goes back to the stream as soon as the lease is released
+		
+		FrameLease raw = LeaseBuffer(stream, buffer);
+		
+		// incomplete buffers were pushed back above, so they show up here as gaps
+		uint64_t missing = frameIds.update(raw->frameId);
+		clock.add(*raw);
+		if (missing > 0) ofLogVerbose("ofxAravis") << "Dropped " << missing << " frames before frame " << raw->frameId;
+		
+		if (queueSettings.enabled) {
+			frameQueue.push(std::move(raw));
+		} else {
+			processFrame(std::move(raw));
 		}
 	}
 
-	void Grabber::setPixels(cv::Mat &m) {
-		mutex.lock();
-		p_last_frame = Clock::now();
-		mat = m.clone();
-		mutex.unlock();
-		bFrameNew = true;
+	void Grabber::processFrame(FrameLease raw) {
 		
-		float time = ofGetElapsedTimef();
-		fpsTimeElapsed = time - previousTimestamp;
-		previousTimestamp = time;
+		if (conversionPool.isRunning()) {
+			conversionPool.submit(std::move(raw));
+		} else {
+			FrameLease out = convertFrame(std::move(raw));
+			if (out) deliverFrame(std::move(out));
+		}
+	}
+
+	FrameLease Grabber::convertFrame(FrameLease raw) {
+		
+		if (!GetPixelFormatInfo(raw->pixelFormat)) {
+			ofLogError("ofxAravis") << "Unknown pixel format";
+			return nullptr;
+		}
+		
+		auto w = raw->width;
+		auto h = raw->height;
+		
+		std::shared_ptr<Frame> out = framePool.acquire(size_t(w) * h * 3);
+		out->width = w;
+		out->height = h;
+		out->step = w * 3;
+		out->pixelFormat = ARV_PIXEL_FORMAT_RGB_8_PACKED;
+		CopyFrameInfo(*raw, *out);
+		
+		// straight to interleaved RGB, packed formats are unpacked on the way, no per frame allocation
+		uint64_t start = StatsCollector::Now();
+		if (!ConvertToRGB8(*raw, out->data, out->step)) {
+			ofLogError("ofxAravis") << "Incomplete frame";
+			return nullptr;
+		}
+		stats.record(METRIC_CONVERSION, StatsCollector::Now() - start);
+		
+		return out;
+	}
+
+	void Grabber::deliverFrame(FrameLease out) {
+		
+		setPixels(out);
+		
+		uint64_t start = StatsCollector::Now();
+		if (bufferCallback) {
+			cv::Mat matRgb(out->height, out->width, CV_8UC3, out->data);
+			bufferCallback(matRgb);
+		}
+		if (frameCallback) frameCallback(out);
+		if (bufferCallback || frameCallback) stats.record(METRIC_CALLBACK, StatsCollector::Now() - start);
+	}
+
+	void Grabber::setPixels(const FrameLease &lease) {
+		p_last_frame = Clock::now().time_since_epoch().count();
+		if (lease->systemTimestamp > 0) {
+			latency = int64_t(HostTimestamp() - lease->systemTimestamp);
+			if (latency > 0) stats.record(METRIC_LATENCY, uint64_t(latency.load()));
+		}
+		mailbox.write(lease);
 		totalFrames = totalFrames + 1;
 	}
 
+	FrameLease Grabber::getFrame() {
+		return mailbox.get();
+	}
+
 	void HandleError( GError * err ) {
 		if ( err != NULL ) {
 			ofLogError("ofxAravis") << "ERROR:" << err->message;
@@ -90,6 +127,8 @@ namespace ofxAravis {
 	// ------- EXPOSURE TIME -------
 
 	bool Grabber::hasExposureTime() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return false;
 		GError *err = nullptr;
 		bool has = arv_camera_is_exposure_time_available( camera, &err );
 		HandleError( err );
@@ -97,12 +136,17 @@ namespace ofxAravis {
 	}
 
 	void Grabber::setExposureTime( double value ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
 		GError *err = nullptr;
 		arv_camera_set_exposure_time(camera, value, &err);
 		HandleError( err );
+		poller.refresh("ExposureTime");
 	}
 
 	double Grabber::getExposureTime() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return 0;
 		GError *err = nullptr;
 		double value = arv_camera_get_exposure_time(camera, &err);
 		HandleError( err );
@@ -111,6 +155,8 @@ namespace ofxAravis {
 
 
 	Bounds Grabber::getExposureBounds() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return Bounds();
 		GError *err = nullptr;
 		Bounds minMax;
 		arv_camera_get_exposure_time_bounds(camera, &minMax.max, &minMax.min, &err);
@@ -122,6 +168,8 @@ namespace ofxAravis {
 	// ------- EXPOSURE TIME AUTO -------
 
 	bool Grabber::hasExposureTimeAuto() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return false;
 		GError *err = nullptr;
 		bool has = arv_camera_is_exposure_auto_available( camera, &err );
 		HandleError( err );
@@ -129,12 +177,18 @@ namespace ofxAravis {
 	}
 
 	void Grabber::setExposureTimeAuto( ArvAuto mode ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
 		GError *err = nullptr;
 		arv_camera_set_exposure_time_auto(camera, mode, &err);
 		HandleError( err );
+		registers.invalidate();
+		poller.refresh("ExposureTimeAuto");
 	}
 
 	ArvAuto Grabber::getExposureTimeAuto() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return ARV_AUTO_OFF;
 		GError *err = nullptr;
 		ArvAuto mode = arv_camera_get_exposure_time_auto(camera, &err);
 		HandleError( err );
@@ -144,14 +198,19 @@ namespace ofxAravis {
 	// ------- TRIGGER MODE -------
 
 	void Grabber::setTriggerMode( std::string key ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
 		ofLog() << "setting trigger source:" << key;
 		GError *err = nullptr;
 		const char * keyChar = key.c_str();
 		arv_camera_set_trigger( camera, keyChar, &err );
 		HandleError( err );
+		poller.refresh("TriggerSource");
 	}
 
 	vector<std::string> Grabber::getAvailableTriggerModes( ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return {};
 		guint numValues;
 		GError *err = nullptr;
 		const char ** array = arv_camera_dup_available_triggers( camera, &numValues, &err);
@@ -165,22 +224,29 @@ namespace ofxAravis {
 	// ------- TRIGGER SOURCE -------
 
 	void Grabber::setTriggerSource( std::string key ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
 		ofLog() << "setting trigger source:" << key;
 		GError *err = nullptr;
 		const char * keyChar = key.c_str();
 		arv_camera_set_trigger_source( camera, keyChar, &err );
 		HandleError( err );
+		poller.refresh("TriggerSource");
 	}
 
 	std::string Grabber::getTriggerSource( ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return "";
 		GError *err = nullptr;
 		const char * modeChar = arv_camera_get_trigger_source( camera, &err );
 		HandleError( err );
-		std::string modeStr( modeChar );
+		std::string modeStr( modeChar ? modeChar : "" );
 		return modeStr;
 	}
 
 	vector<std::string> Grabber::getAvailableTriggerSources( ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return {};
 		guint numValues;
 		GError *err = nullptr;
 		const char ** array = arv_camera_dup_available_trigger_sources( camera, &numValues, &err);
@@ -196,6 +262,8 @@ namespace ofxAravis {
 	
 
 	vector<std::string> Grabber::getAvailableEnumerations( std::string key ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return {};
 		guint numValues;
 		GError *err = nullptr;
 		const char ** array = arv_camera_dup_available_enumerations_as_strings( camera, key.c_str(), &numValues, &err);
@@ -215,224 +283,47 @@ namespace ofxAravis {
     }
 
     ofJson Grabber::listAllFeatures() {
-
-        ofJson features;
-
-        ArvDevice * device;
-        device = arv_camera_get_device( camera );
-
-        ArvGc * genicam;
-        genicam = arv_device_get_genicam( device );
-        
-        ofLog() << "listing all features...";
-        loopThroughFeatures( features, genicam, "Root", 0 );
-    
-        ofLog() << features;
-        
-        return features;
+        FeatureTreeOptions options;
+        options.values = true;
+        return getFeatureTree( options ).toNestedJson();
     }
 
-	void Grabber::loopThroughFeatures( ofJson & features, ArvGc * genicam, const char * feature, int level ) {
-
-		ArvGcNode * node;
-		node = arv_gc_get_node( genicam, feature );
-
-		bool isFeature = ARV_IS_GC_FEATURE_NODE(node);
-		bool isImplemented = arv_gc_feature_node_is_implemented(ARV_GC_FEATURE_NODE(node), NULL);
-
-		if ( isFeature && isImplemented ) {
-
-			processFeatureNode( features, ARV_GC_FEATURE_NODE(node), level );
-
-			if ( ARV_IS_GC_CATEGORY(node) ) {
-
-				const GSList * featuresList;
-				const GSList * iter;
+	FeatureTree Grabber::getFeatureTree( const FeatureTreeOptions & options ) {
 
-                features["children"] = ofJson::array();
-
-                featuresList = arv_gc_category_get_features( ARV_GC_CATEGORY(node) );
-				int i = 0;
-
-				for (iter = featuresList; iter != NULL; iter = iter->next) {
-	                const char * featureName = static_cast<const char *>(iter->data);
-                    ofJson childJson;
-					loopThroughFeatures( features["children"][i], genicam, featureName, level + 1 );
-                    i += 1;
-				}
-			}
-		}
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return FeatureTree();
 
+		// the index comes from disk or one DOM walk on first use, later calls copy the part they ask for
+		if (featureTree.empty()) genicamCache.loadOrBuild( camera, features, featureTree );
 
+		FeatureTree tree = featureTree.subtree( options.root, options.maxDepth );
+		if (options.values) tree.readValues( features );
+		return tree;
 	}
 
 
-	void Grabber::processFeatureNode( ofJson & entry, ArvGcFeatureNode * node, int level ) {
-
-			std::string nodeType = safeConvertChars( arv_dom_node_get_node_name (ARV_DOM_NODE (node)) );
-			std::string featureName = safeConvertChars( arv_gc_feature_node_get_name (node) );
-        
-            entry["nodeType"] = nodeType;
-            entry["featureName"] = featureName;
-
-			bool isEnumeration = ARV_IS_GC_ENUMERATION( node );
-        
-            ofLog() << "======" << nodeType+":"+featureName << "======";
-
-            if (arv_gc_feature_node_is_available (node, NULL)) {
-
-                bool isSelector = ARV_IS_GC_SELECTOR(node) && arv_gc_selector_is_selector( ARV_GC_SELECTOR( node ) );
-
-                char *value = NULL;
-                GError *error = NULL;
-
-                std::string accessMode = ofToString( arv_gc_access_mode_to_string( arv_gc_feature_node_get_actual_access_mode(node) ));
-                
-                entry["accessMode"] = accessMode;
-
-                if (true) { // list_mode == ARV_TOOL_LIST_MODE_VALUES) {
-
-                    const char * unit;
-
-                    if (ARV_IS_GC_STRING(node) || isEnumeration) {
-
-                        std::string value = arv_gc_string_get_value( ARV_GC_STRING(node), &error);
-                        
-                        entry["value"] = value;
-                        ofLog() << "string:" << value;
-
-                    } else if (ARV_IS_GC_INTEGER (node)) {
-
-                        if (isEnumeration) {
-
-                            std::string value = arv_gc_string_get_value( ARV_GC_STRING(node), &error );
-                            
-                            entry["value"] = value;
-                            ofLog() << "enum:" << value;
-
-                        } else {
-
-                            std::string unit = safeConvertChars( arv_gc_integer_get_unit( ARV_GC_INTEGER(node) ) );
-                            int value = arv_gc_integer_get_value (ARV_GC_INTEGER (node), &error);
-                            
-                            entry["value"] = value;
-                            if (unit != "N/A") entry["unit"] = unit;
-                            
-                            ofLog() << "enum + unit:" << value << " / " << unit;
-
-                        }
-                    } else if (ARV_IS_GC_FLOAT (node)) {
-
-                        std::string unit = safeConvertChars( arv_gc_float_get_unit( ARV_GC_FLOAT(node) ) );
-                        float value = arv_gc_float_get_value( ARV_GC_FLOAT (node), &error);
-                        
-                        entry["value"] = value;
-                        if (unit != "N/A") entry["unit"] = unit;
-                        
-                        ofLog() << "float + unit:" << value << " / " + unit;
-
-                    } else if (ARV_IS_GC_BOOLEAN (node)) {
-
-                        bool value = arv_gc_boolean_get_value( ARV_GC_BOOLEAN(node), &error );
-                        entry["value"] = value;
-                        
-                        ofLog() << "bool:" << (value ? "true" : "false");
-
-                    }
-                }
-
-
-                if (isSelector) {
-
-                        const GSList * iter;
-                        vector<std::string> options;
-                        int i = 0;
-                    
-                        entry["options"] = ofJson::array();
-
-                        // Get the list of selected feature nodes
-                        const GSList *selectedFeatures = arv_gc_selector_get_selected_features(ARV_GC_SELECTOR(node));
-
-                        for (iter = selectedFeatures; iter != NULL; iter = iter->next) {
-                            // Cast iter->data to an ArvGcFeatureNode*
-                            ArvGcFeatureNode * featureNode = ARV_GC_FEATURE_NODE(iter->data);
-                            std::string option = safeConvertChars(arv_gc_feature_node_get_name(featureNode));
-                            
-                            entry["enum"][i] = option;
-                            ofLog() << "--->" << i << option;
-                            options.push_back(option);
-                            i += 1;
-                        }
-
-                }
-			}
-
-
-			std::string description = safeConvertChars( arv_gc_feature_node_get_description(node) );
-        
-            entry["description"] = description;
-			ofLog() << "description:" << description;
-        
-            if (isEnumeration) {
-                const GSList *childs;
-                const GSList *iter;
-
-                // Get the list of entries for the enumeration
-                childs = arv_gc_enumeration_get_entries(ARV_GC_ENUMERATION(node));
-
-                int i = 0;
-                entry["enum"] = ofJson::array();
-
-                for (iter = childs; iter != NULL; iter = iter->next) {
-                    // Cast iter->data to ArvGcFeatureNode*
-                    ArvGcFeatureNode *featureNode = ARV_GC_FEATURE_NODE(iter->data);
-                    
-                    if (arv_gc_feature_node_is_implemented(featureNode, NULL)) {
-                        // Cast iter->data to ArvDomNode* for getting the node name
-                        ArvDomNode *domNode = ARV_DOM_NODE(iter->data);
-
-                        std::string childNodeType = safeConvertChars(arv_dom_node_get_node_name(domNode));
-                        std::string childFeatureName = safeConvertChars(arv_gc_feature_node_get_name(featureNode));
-                        bool childFeatureIsAvailable = arv_gc_feature_node_is_available(featureNode, NULL);
-                        
-                        ofJson childEntry;
-                        childEntry["nodeType"] = childNodeType;
-                        childEntry["featureName"] = childFeatureName;
-                        childEntry["isAvailable"] = childFeatureIsAvailable;
-                        
-                        entry["enum"][i] = childEntry;
-
-                        ofLog() << "--->" << i << " " << childNodeType << " " << childFeatureName << " " << (childFeatureIsAvailable ? "Available" : "Not available");
-
-                        i += 1;
-                    }
-                }
-            }
-
-	}
-
+	// feature access goes through cached node handles, see FeatureCache
 
 	void Grabber::setFeatureString( std::string key, std::string value ) {
 			ofLog() << "setting string feature:" << key << value;
 			GError *err = nullptr;
-			const char * keyChar = key.c_str();
-			const char * valChar = value.c_str();
-			arv_camera_set_string( camera, keyChar, valChar, &err );
+			features.setString( key, value, &err );
 			HandleError( err );
+			registers.invalidate( key );
+			poller.refresh( key );
 	}
 
 	void Grabber::executeCommand( std::string command ) {
-		const char * commandChars = command.c_str();
 		GError *err = nullptr;
 		ofLog() << "executing command:" << command;
-		arv_camera_execute_command( camera, commandChars, &err);
+		features.execute( command, &err );
 		HandleError( err );
+		registers.invalidate( command );
 	}
 	std::string Grabber::getFeatureString( std::string key ) {
 			GError *err = nullptr;
-			const char * keyChar = key.c_str();
-			auto res = arv_camera_get_string( camera, keyChar, &err );
-			std::string value = (res == NULL) ? "ERROR" : std::string(res);
+			std::string value = features.getString( key, &err );
+			if (err || !features.resolve( key )) value = "ERROR";
 			HandleError( err );
 			return value;
 	}
@@ -440,47 +331,37 @@ namespace ofxAravis {
 	void Grabber::setFeatureBoolean( std::string key, bool value ) {
 			ofLog() << "setting bool feature:" << key << value;
 			GError *err = nullptr;
-			const char * keyChar = key.c_str();
-			arv_camera_set_boolean( camera, keyChar, value, &err );
+			features.setBoolean( key, value, &err );
 			HandleError( err );
+			registers.invalidate( key );
 	}
 	bool Grabber::getFeatureBoolean( std::string key ) {
 			GError *err = nullptr;
-			const char * keyChar = key.c_str();
-			auto res = arv_camera_get_boolean( camera, keyChar, &err );
-			bool value = (res == NULL) ? false : bool(res);
+			bool value = features.getBoolean( key, &err );
 			HandleError( err );
 			return value;
 	}
 
-	void Grabber::setFeatureInteger( std::string key, int value ) {
+	void Grabber::setFeatureInteger( std::string key, gint64 value ) {
 			ofLog() << "setting integer feature:" << key << value;
-			GError *err = nullptr;
-			const char * keyChar = key.c_str();
-			arv_camera_set_integer( camera, keyChar, gint64(value), &err );
-			HandleError( err );
+			setFeature<gint64>( key, value );
 	}
-	int Grabber::getFeatureInteger( std::string key ) {
+	gint64 Grabber::getFeatureInteger( std::string key ) {
 			GError *err = nullptr;
-			const char * keyChar = key.c_str();
-			auto res = arv_camera_get_integer( camera, keyChar, &err );
-			int value = (res == NULL) ? -1 : int(res);
+			gint64 res = features.get<gint64>( key, &err );
+			gint64 value = (err || !features.resolve( key )) ? -1 : res;
 			HandleError( err );
 			return value;
 	}
 	
-	void Grabber::setFeatureFloat( std::string key, int value ) {
+	void Grabber::setFeatureFloat( std::string key, double value ) {
 			ofLog() << "setting float feature:" << key << value;
-			GError *err = nullptr;
-			const char * keyChar = key.c_str();
-			arv_camera_set_float( camera, keyChar, gint64(value), &err );
-			HandleError( err );
+			setFeature<double>( key, value );
 	}
-   float Grabber::getFeatureFloat( std::string key ) {
+	double Grabber::getFeatureFloat( std::string key ) {
 			GError *err = nullptr;
-			const char * keyChar = key.c_str();
-			auto res = arv_camera_get_float( camera, keyChar, &err );
-			float value = (res == NULL) ? -1.0 : float(res);
+			double res = features.get<double>( key, &err );
+			double value = (err || !features.resolve( key )) ? -1.0 : res;
 			HandleError( err );
 			return value;
 	}
@@ -488,17 +369,26 @@ namespace ofxAravis {
 	// ------- FPS -------
 
 	void Grabber::setFPS( double fps ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
 		GError *err = nullptr;
 		arv_camera_set_frame_rate(camera, fps, &err);
 		HandleError( err );
+		features.invalidateBounds("AcquisitionFrameRate");
+		poller.refresh("FPS");
+		poller.refresh("FPSBounds");
 	}
 	double Grabber::getFPS() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return 0;
 		GError *err = nullptr;
 		double fps = arv_camera_get_frame_rate(camera, &err);
 		HandleError( err );
 		return fps;
 	}
 	double Grabber::getMinFPS() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return 0;
 		GError *err = nullptr;
 		double min;
 		double max;
@@ -507,6 +397,8 @@ namespace ofxAravis {
 		return min;
 	}
 	double Grabber::getMaxFPS() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return 0;
 		GError *err = nullptr;
 		double min;
 		double max;
@@ -515,18 +407,30 @@ namespace ofxAravis {
 		return max;
 	}
 	float Grabber::getActualFPS() {
-		return float( 1.0 / fpsTimeElapsed );
+		return float( stats.getSnapshot().fps );
+	}
+
+	StatsSnapshot Grabber::getStats() {
+		StatsSnapshot snapshot = stats.getSnapshot();
+		snapshot.dropped = frameIds.getDropped();
+		return snapshot;
 	}
 
 	// ------- FORMAT -------
 
 	void Grabber::setPixelFormat( std::string format ) {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
 		GError *err = nullptr;
 		const char * formatChar = format.c_str();
 		arv_camera_set_pixel_format_from_string(camera, formatChar, &err);
 		HandleError( err );
+		features.invalidateBounds("PixelFormat");
+		poller.refresh("PixelFormat");
 	}
 	std::string Grabber::getPixelFormat() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return "ERROR";
 		GError *err = nullptr;
 		auto res = arv_camera_get_pixel_format_as_string(camera, &err );
 		std::string value = (res == NULL) ? "ERROR" : std::string(res);
@@ -535,39 +439,17 @@ namespace ofxAravis {
 	}
 
 	bool Grabber::update() {
-		if (bFrameNew) {
-			bFrameNew = false;
-			mutex.lock();
-			image.setFromPixels(mat.data, width, height, ofImageType::OF_IMAGE_COLOR);
-			mutex.unlock();
-			return true;
-		} else {
-			return false;
-		}
-	}
-
-	Device GetDeviceInfo( int idx ) {
-		
-		ofxAravis::Device device;
-		
-		device.id = arv_get_device_id(idx);
-		device.physical_id = arv_get_device_physical_id(idx);
-		device.address = arv_get_device_address(idx);
-		device.vendor = arv_get_device_vendor(idx);
-		device.manufacturer_info = arv_get_device_manufacturer_info(idx);
-		device.model = arv_get_device_model(idx);
-		device.serial_nbr = arv_get_device_serial_nbr(idx);
-		device.protocol = arv_get_device_protocol(idx);
-		
-		return device;
+		if (!mailbox.update()) return false;
+		FrameLease & lease = mailbox.get();
+		if (!lease) return false;
+		image.setFromPixels(lease->data, lease->width, lease->height, ofImageType::OF_IMAGE_COLOR);
+		return true;
 	}
 
 	std::vector<Device> ListAllDevices( bool print ){
-		arv_update_device_list();
 		std::vector<Device> devices;
-		for (int i = 0; i < arv_get_n_devices(); i++) {
-			
-			ofxAravis::Device device = GetDeviceInfo( i );
+		for (auto & device : GetDiscoveryService().scan()) {
+			int i = devices.size();
 			
 			if (print) {
 				
@@ -589,7 +471,7 @@ namespace ofxAravis {
 
 	Grabber::Grabber() {
 		ofLogNotice("ofxAravis") << "created";
-		p_last_frame = Clock::now();
+		p_last_frame = Clock::now().time_since_epoch().count();
 		ofAddListener(ofEvents().exit, this, &Grabber::onAppExit);
 	}
 
@@ -603,35 +485,190 @@ namespace ofxAravis {
 		stop();
 	}
 
+	FeaturePoller & Grabber::getPoller() {
+		return poller;
+	}
+
+	std::future<ControlResult> Grabber::setFeatureAsync( std::string key, ofJson value, ControlCallback callback ) {
+		return controlChannel.set( key, value, [this, key, callback]( const ControlResult & result ) {
+			if (result.ok) registers.invalidate( key );
+			if (result.ok) poller.refresh( key );
+			else ofLogError("ofxAravis") << "setFeatureAsync " << key << ": " << result.message;
+			if (callback) callback( result );
+		});
+	}
+
+	std::future<ControlResult> Grabber::getFeatureAsync( std::string key, ControlCallback callback ) {
+		return controlChannel.get( key, callback );
+	}
+
+	std::future<ControlResult> Grabber::executeCommandAsync( std::string command, ControlCallback callback ) {
+		return controlChannel.execute( command, callback );
+	}
+
+	ControlChannel & Grabber::getControlChannel() {
+		return controlChannel;
+	}
+
+	bool Grabber::enableFastPath( std::string key ) {
+		if (!isInitialized()) return false;
+		return registers.enable( key );
+	}
+
+	void Grabber::disableFastPath( std::string key ) {
+		registers.disable( key );
+	}
+
+	bool Grabber::setFeatureFast( std::string key, double value ) {
+		GError *err = nullptr;
+		bool ok = registers.set( key, value, &err );
+		HandleError( err );
+		return ok;
+	}
+
+	RegisterFastPath & Grabber::getRegisterFastPath() {
+		return registers;
+	}
+
+	int Grabber::subscribe( std::string key, double interval, FeaturePoller::Callback callback, double tolerance ) {
+		if (!isInitialized()) return -1;
+		int id = poller.subscribe( key, interval, callback, [this, key] {
+			GError *err = nullptr;
+			ofJson value = features.getValue( key, &err );
+			g_clear_error( &err );
+			return value;
+		}, tolerance );
+		startPoller();
+		return id;
+	}
+
+	void Grabber::unsubscribe( int id ) {
+		poller.unsubscribe( id );
+	}
+
+	void Grabber::startPoller() {
+		// each cycle's reads run under the control lock, so they never interleave with feature writes
+		poller.setCycleMutex(&features.getControlMutex());
+		poller.start();
+	}
+
+	namespace {
+		// poller readers fail quietly, a null value is what counts them as failed
+		bool ReadFailed( GError * err ) {
+			if (!err) return false;
+			g_clear_error( &err );
+			return true;
+		}
+	}
+
+	void Grabber::startInfoPolling() {
+		
+		// drawInfo state, refreshed in the background at a pace that suits each value; what the
+		// camera doesn't implement isn't polled, so drawInfo shows "-" instead of logging every cycle
+		
+		infoPolling = true;
+		
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
+		GError *err = nullptr;
+		bool hasFrameRate = arv_camera_is_frame_rate_available( camera, &err ) && !ReadFailed( err );
+		err = nullptr;
+		bool hasExposure = arv_camera_is_exposure_time_available( camera, &err ) && !ReadFailed( err );
+		err = nullptr;
+		bool hasExposureAuto = arv_camera_is_exposure_auto_available( camera, &err ) && !ReadFailed( err );
+		
+		auto feature = [this]( std::string key ) {
+			return [this, key]() -> ofJson {
+				GError *err = nullptr;
+				ofJson value = features.getValue( key, &err );
+				return ReadFailed( err ) ? ofJson() : value;
+			};
+		};
+		
+		// readers run under the control lock, see startPoller, camera is only swapped under it
+		if (hasFrameRate) {
+			poller.add("FPS", 0.5, [this]() -> ofJson {
+				GError *err = nullptr;
+				double fps = camera ? arv_camera_get_frame_rate( camera, &err ) : 0;
+				return camera && !ReadFailed( err ) ? ofJson(fps) : ofJson();
+			});
+			poller.add("FPSBounds", 5.0, [this]() -> ofJson {
+				GError *err = nullptr;
+				double min = 0, max = 0;
+				if (camera) arv_camera_get_frame_rate_bounds( camera, &min, &max, &err );
+				return camera && !ReadFailed( err ) ? ofJson{ { "min", min }, { "max", max } } : ofJson();
+			});
+		}
+		poller.add("PixelFormat", 2.0, feature("PixelFormat"));
+		if (hasExposure) {
+			poller.add("ExposureTime", 0.25, [this]() -> ofJson {
+				GError *err = nullptr;
+				double value = camera ? arv_camera_get_exposure_time( camera, &err ) : 0;
+				return camera && !ReadFailed( err ) ? ofJson(value) : ofJson();
+			});
+			poller.add("ExposureBounds", 5.0, [this]() -> ofJson {
+				GError *err = nullptr;
+				double min = 0, max = 0;
+				if (camera) arv_camera_get_exposure_time_bounds( camera, &min, &max, &err );
+				return camera && !ReadFailed( err ) ? ofJson{ { "min", min }, { "max", max } } : ofJson();
+			});
+		}
+		if (hasExposureAuto) {
+			poller.add("ExposureTimeAuto", 1.0, [this]() -> ofJson {
+				GError *err = nullptr;
+				ArvAuto mode = camera ? arv_camera_get_exposure_time_auto( camera, &err ) : ARV_AUTO_OFF;
+				return camera && !ReadFailed( err ) ? ofJson(int(mode)) : ofJson();
+			});
+		}
+		if (features.resolve("TriggerSource")) poller.add("TriggerSource", 2.0, feature("TriggerSource"));
+		if (features.resolve("GainAuto")) poller.add("GainAuto", 1.0, feature("GainAuto"));
+		startPoller();
+		
+		if (availableTriggerModes.size() == 0) {
+			availableTriggerModes = getAvailableTriggerModes();
+		}
+		if (availableTriggerSources.size() == 0) {
+			availableTriggerSources = getAvailableTriggerSources();
+		}
+	}
+
 	void Grabber::drawInfo( int x, int y ) {
 		
 		glm::vec2 center = glm::vec2( ofGetWidth()/2, ofGetHeight()/2 );
 		
+		// everything comes from the poller cache, the GL thread never waits on the camera
+		
+		if (isInitialized() && !infoPolling) startInfoPolling();
+		
+		auto cached = [this](const std::string & key, const std::string & field = "") {
+			ofJson value;
+			if (!poller.get(key, value)) return std::string("-");
+			if (!field.empty()) value = value[field];
+			if (value.is_string()) return value.get<std::string>();
+			if (value.is_number()) return ofToString(value.get<double>());
+			return value.dump();
+		};
+		
 		std::string model = getInfo().model;
-		std::string FPS = ofToString(getFPS());
-		std::string minFPS = ofToString(getMinFPS());
-		std::string maxFPS = ofToString(getMaxFPS());
+		std::string FPS = cached("FPS");
+		std::string minFPS = cached("FPSBounds", "min");
+		std::string maxFPS = cached("FPSBounds", "max");
 		std::string appFPS = ofToString(int(ofGetFrameRate()));
 //        std::string temp = ofToString(getTemperature());
-		std::string currentFormat = getPixelFormat();
+		std::string currentFormat = cached("PixelFormat");
 		std::string sensorWidth = ofToString(getSensorWidth());
 		std::string sensorHeight = ofToString(getSensorHeight());
 		std::string actualFPS = ofToString(getActualFPS());
-		std::string gainAuto = ofToString(getFeatureString( "GainAuto" ));
+		std::string gainAuto = cached("GainAuto");
 		
-		std::string expValue = ofToString(getExposureTime());
-		ArvAuto expAuto = getExposureTimeAuto();
-		std::string expAutoMode = expAuto == 0 ? "ARV_AUTO_OFF" : expAuto == 1 ? "ARV_AUTO_ONCE" : "ARV_AUTO_CONTINUOUS";
+		std::string expValue = cached("ExposureTime");
+		std::string expAuto = cached("ExposureTimeAuto");
+		std::string expAutoMode = expAuto == "0" ? "ARV_AUTO_OFF" : expAuto == "1" ? "ARV_AUTO_ONCE" : expAuto == "2" ? "ARV_AUTO_CONTINUOUS" : "-";
 		
-		Bounds exposureBounds = getExposureBounds();
+		std::string expMin = cached("ExposureBounds", "min");
+		std::string expMax = cached("ExposureBounds", "max");
 		
-		std::string triggerSource = getTriggerSource();
-		if (availableTriggerModes.size() == 0) {
-			availableTriggerModes = getAvailableTriggerModes();
-		}
-		if (availableTriggerSources.size() == 0) {
-			availableTriggerSources = getAvailableTriggerSources();
-		}
+		std::string triggerSource = cached("TriggerSource");
 		
 		if (isInited()) {
 			ofDrawBitmapStringHighlight(model, glm::vec2(x,y+0), ofColor::white, ofColor::black);
@@ -644,8 +681,8 @@ namespace ofxAravis {
 			ofDrawBitmapStringHighlight("FPS MIN / MAX: " + minFPS + " / " + maxFPS, glm::vec2(x,y+120));
 			ofDrawBitmapStringHighlight("ACTUAL FPS: " + actualFPS, glm::vec2(x,y+140));
 			ofDrawBitmapStringHighlight("TRIGGER SOURCE: " + triggerSource, glm::vec2(x,y+160));
-			ofDrawBitmapStringHighlight("EXPOSURE BOUNDS: " + ofToString(exposureBounds.min) + " / " + ofToString(exposureBounds.max), glm::vec2(x,y+180));
-			ofDrawBitmapStringHighlight("TOTAL FRAMES: " + ofToString(totalFrames), glm::vec2(x,y+200));
+			ofDrawBitmapStringHighlight("EXPOSURE BOUNDS: " + expMin + " / " + expMax, glm::vec2(x,y+180));
+			ofDrawBitmapStringHighlight("TOTAL FRAMES: " + ofToString(totalFrames) + " / DROPPED: " + ofToString(getDroppedFrames()), glm::vec2(x,y+200));
 			ofDrawBitmapStringHighlight("GAIN AUTO: " + gainAuto, glm::vec2(x,y+220));
 		} else {
 			ofDrawBitmapStringHighlight("UNINITIALISED.", glm::vec2(x, y+0));
@@ -656,6 +693,58 @@ namespace ofxAravis {
 		targetPixelFormat = format;
 	}
 
+	void Grabber::setAcquisitionSettings(AcquisitionSettings settings) {
+		acquisitionSettings = settings;
+	}
+
+	void Grabber::setBufferPoolSettings(BufferPoolSettings settings) {
+		bufferPoolSettings = settings;
+	}
+
+	void Grabber::setQueueSettings(QueueSettings settings) {
+		queueSettings = settings;
+	}
+
+	QueueStats Grabber::getQueueStats() {
+		return frameQueue.getStats();
+	}
+
+	void Grabber::setConversionWorkers(int workers) {
+		conversionWorkers = workers;
+	}
+
+	void Grabber::setWorkerPool(WorkerPool * pool) {
+		workerPool = pool;
+	}
+
+	void Grabber::setGenicamCacheSettings(GenicamCacheSettings settings) {
+		genicamCache.setSettings(settings);
+	}
+
+	uint64_t Grabber::getDroppedFrames() {
+		return frameIds.getDropped();
+	}
+
+	uint64_t Grabber::getReceivedFrames() {
+		return frameIds.getReceived();
+	}
+
+	guint64 Grabber::getLastFrameId() {
+		return frameIds.getLastFrameId();
+	}
+
+	double Grabber::getLatency() {
+		return latency / 1e6;
+	}
+
+	ClockModel & Grabber::getClockModel() {
+		return clock;
+	}
+
+	guint64 Grabber::toHostTime(guint64 deviceTimestamp) {
+		return clock.toHost(deviceTimestamp);
+	}
+
 	Device & Grabber::getInfo() {
 		return info;
 	}
@@ -666,31 +755,65 @@ namespace ofxAravis {
 
 	bool Grabber::setup( int targetCamera, int targetX, int targetY, int targetWidth, int targetHeight, const char * targetPixelFormat ) {
 		
-		stop();
-		bFrameNew = false;
-		totalFrames = 0;
-		previousTimestamp = ofGetElapsedTimef();
-		fpsTimeElapsed = 0;
+		// indices follow the last scan, which is only repeated once it is older than the TTL
+		std::vector<Device> devices = GetDiscoveryService().getDevices();
 		
-		GError *err = nullptr;
-		
-		if ( targetCamera >= ofxAravis::ListAllDevices(false).size() ) {
+		if ( targetCamera < 0 || targetCamera >= devices.size() ) {
+			stop();
 			ofLogError("ofxAravis") << "No camera to open at: " << targetCamera;
 			inited = false;
 			return inited;
 		}
 		
-		info = GetDeviceInfo( targetCamera );
-		camera = arv_camera_new(info.id.c_str(), &err);
+		return setup( devices[targetCamera], targetX, targetY, targetWidth, targetHeight, targetPixelFormat );
+	}
+
+	bool Grabber::setup( const std::string & name, int targetX, int targetY, int targetWidth, int targetHeight, const char * targetPixelFormat ) {
+		
+		Device device;
+		if ( !GetDiscoveryService().find( name, device ) ) {
+			// Aravis also resolves GigE user ids, which the device list doesn't carry
+			ofLogNotice("ofxAravis") << "No device " << name << " in the device list, opening it by name";
+			device.id = name;
+		}
+		
+		return setup( device, targetX, targetY, targetWidth, targetHeight, targetPixelFormat );
+	}
+
+	bool Grabber::setup( const Device & device, int targetX, int targetY, int targetWidth, int targetHeight, const char * targetPixelFormat ) {
+		
+		stop();
+		totalFrames = 0;
+		frameIds.reset();
+		clock.reset();
+		latency = 0;
+		stats.reset();
+		
+		GError *err = nullptr;
+		
+		// held through configuration and the stream start, nothing else may use the camera half set up
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		
+		info = device;
+		{
+			std::shared_lock<std::shared_mutex> list(GetDeviceListMutex());
+			camera = arv_camera_new(info.id.c_str(), &err);
+		}
+		features.setCamera(camera);
+		registers.setCamera(camera, &features);
+		opened = camera != nullptr;
 		
 		HandleError( err );
 		
 		if (!camera) {
-			ofLogError("ofxAravis") << "No camera could be created at: " << targetCamera;
+			ofLogError("ofxAravis") << "No camera could be created at: " << info.id;
 			inited = false;
 			return inited;
 		}
 		
+		controlChannel.setFeatures(&features);
+		controlChannel.start();
+		
 		arv_camera_get_region(camera, &initX, &initY, &initWidth, &initHeight, &err);
 		HandleError( err );
 		initPixelFormat = arv_camera_get_pixel_format_as_string( camera, &err );
@@ -755,6 +878,7 @@ namespace ofxAravis {
 		HandleError( err );
 		arv_camera_set_pixel_format_from_string(camera, araPixelFormat, &err);
 		HandleError( err );
+		features.invalidateBounds();
 		
 		// B) GETTING ...
 		
@@ -771,7 +895,19 @@ namespace ofxAravis {
 		
 		ofLogNotice("ofxAravis") << "GRABBER SET TO: " << x << ", " << y << ", " << width << ", " << height << ", " << pixelFormat;
 		
-		image.allocate(width, height, ofImageType::OF_IMAGE_GRAYSCALE);
+		// the texture needs the GL context, opened elsewhere the first update() allocates it
+		if (ofThread::isMainThread()) image.allocate(width, height, ofImageType::OF_IMAGE_GRAYSCALE);
+		
+		inited = startStream();
+		
+		return inited;
+	}
+
+	bool Grabber::startStream() {
+		
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return false;
+		GError *err = nullptr;
 		
 		auto payload = arv_camera_get_payload(camera, &err);
 		HandleError( err );
@@ -781,64 +917,261 @@ namespace ofxAravis {
 		stream = arv_camera_create_stream(camera, nullptr, nullptr, &err);
 		HandleError( err );
 		
-		int numberOfBuffers = 100;
+		if (stream == nullptr || !bufferPool.allocate(payload, bufferPoolSettings)) {
+			ofLogError("ofxARavis") << "create stream failed";
+			return false;
+		}
+		
+		// buffers come from one preallocated arena that is kept across setup calls
+		bufferPool.push(stream);
+		
+		//start stream
+		arv_camera_start_acquisition(camera, &err);
+		HandleError( err );
+		registers.invalidate(); // TLParamsLocked follows acquisition
+		
+		// demosaic runs on several threads, frames are still delivered in order
+		if (workerPool) {
+			conversionPool.start(*workerPool,
+				[this](FrameLease raw) { return convertFrame(std::move(raw)); },
+				[this](FrameLease out) { deliverFrame(std::move(out)); });
+		} else if (conversionWorkers > 0) {
+			conversionPool.start(conversionWorkers,
+				[this](FrameLease raw) { return convertFrame(std::move(raw)); },
+				[this](FrameLease out) { deliverFrame(std::move(out)); });
+		}
+		
+		// conversion and callbacks run on the dispatch thread when queued, see QueueSettings
+		if (queueSettings.enabled) frameQueue.start(queueSettings, [this](FrameLease lease) { processFrame(std::move(lease)); });
+		
+		// new-buffer signal or our own worker thread, see AcquisitionSettings
+		acquisition.start(stream, acquisitionSettings, [this](ArvStream * s, ArvBuffer * b) { onNewBuffer(s, b); });
+		return true;
+	}
+
+	void Grabber::stopStream() {
+		watchdog.disarm();
+		// joined outside the control lock, a frame callback may be setting a feature
+		acquisition.stop();
+		frameQueue.stop();
+		conversionPool.stop();
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		GError *err = nullptr;
+		if (camera) arv_camera_stop_acquisition(camera, &err);
+		HandleError( err );
+		registers.invalidate();
+		if (stream) g_object_unref(stream);
+		stream = nullptr;
+	}
+
+	ApplyResult Grabber::applyFeatures( const ofJson & values, bool rollback ) {
+		
+		ApplyOptions options;
+		{
+			std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+			if (!camera) return ApplyResult();
+			options.streaming = stream != nullptr;
+		}
+		options.rollback = rollback;
+		
+		// a new size or format changes the payload, so buffers are reallocated on the way back up;
+		// ApplyFeatures lets go of the control lock around pause, so it isn't held here
+		options.pause = [this] { stopStream(); };
+		options.resume = [this] { inited = startStream(); return inited.load(); };
+		
+		ApplyResult result = ApplyFeatures( features, values, options );
+		registers.invalidate();
+		
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return result;
+		
+		GError *err = nullptr;
+		arv_camera_get_region(camera, &x, &y, &width, &height, &err);
+		HandleError( err );
+		pixelFormat = arv_camera_get_pixel_format_as_string(camera, &err);
+		HandleError( err );
+		
+		for (auto & entry : result.features) {
+			if (entry.status == APPLY_WRITTEN) poller.refresh( entry.name );
+			if (entry.status == APPLY_WRITTEN && recoveryConfiguration.is_object()) recoveryConfiguration[entry.name] = entry.value;
+		}
+		poller.refresh("PixelFormat");
+		poller.refresh("FPS");
+		poller.refresh("FPSBounds");
+		poller.refresh("ExposureBounds");
+		
+		return result;
+	}
+
+	// ------- RECOVERY -------
+
+	void Grabber::enableWatchdog( WatchdogSettings settings ) {
+		if (!isInitialized()) return;
+		captureConfiguration();
+		// started first, a watchdog that was already running drops its signal on the way
+		watchdog.start(settings, [this](int attempt) { return reopen(attempt); });
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (camera) watchdog.watch(camera);
+	}
+
+	void Grabber::disableWatchdog() {
+		watchdog.stop();
+	}
+
+	void Grabber::captureConfiguration() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
+		FeatureTreeOptions options;
+		options.values = true;
+		recoveryConfiguration = ProfileToValues(getFeatureTree(options).toJson());
+		ofLogNotice("ofxAravis") << "captured " << recoveryConfiguration.size() << " features for recovery";
+	}
+
+	Watchdog & Grabber::getWatchdog() {
+		return watchdog;
+	}
+
+	// on the watchdog thread: the same device by id, no rescan, and the streaming state of
+	// before minus anything that lived in the old camera object. The old camera goes and the new
+	// one comes under the control lock, so no call on another thread holds either half set up;
+	// opening itself runs outside it, getters meanwhile see no camera
+	
+	bool Grabber::reopen( int attempt ) {
+		
+		// later attempts find the poller already stopped by the first
+		if (attempt == 1) recoveryPolling = poller.isRunning();
+		
+		poller.stop();
+		controlChannel.stop();
+		watchdog.unwatch();
+		
+		std::vector<std::string> fast = registers.getFeatures();
+		
+		// joins the frame threads before taking the lock, a frame callback may be setting a feature
+		stopStream();
+		
+		{
+			std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+			inited = false;
+			opened = false;
+			registers.setCamera(nullptr, nullptr);
+			features.setCamera(nullptr);
+			featureTree.clear();
+			if (camera) g_object_unref(camera);
+			camera = nullptr;
+		}
+		
+		GError *err = nullptr;
+		ArvCamera * reopened = nullptr;
+		{
+			std::shared_lock<std::shared_mutex> list(GetDeviceListMutex());
+			reopened = arv_camera_new(info.id.c_str(), &err);
+		}
+		HandleError( err );
+		g_clear_error( &err );
+		if (!reopened) return false;
 		
-		if (stream != nullptr) {
+		{
+			std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+			
+			camera = reopened;
+			opened = true;
+			features.setCamera(camera);
+			registers.setCamera(camera, &features);
 			
-			// Push 50 buffer in the stream input buffer queue
-			for (int i = 0; i < numberOfBuffers; i++) arv_stream_push_buffer(stream, arv_buffer_new(payload, nullptr));
+			// written in dependency order, and only what the camera doesn't already hold
+			ApplyResult result = ApplyFeatures(features, recoveryConfiguration);
+			if (!result.ok()) ofLogWarning("ofxAravis") << "reopen: " << result.failed << " features not restored";
+			for (auto & name : fast) registers.enable(name);
 			
-			//start stream
-			arv_camera_start_acquisition(camera, &err);
+			pixelFormat = arv_camera_get_pixel_format_as_string(camera, &err);
 			HandleError( err );
 			
-			// Connect the new-buffer signal
-			g_signal_connect(stream, "new-buffer", G_CALLBACK(onNewBuffer), this);
-			arv_stream_set_emit_signals(stream, TRUE);
-			inited = true;
-		} else {
-			ofLogError("ofxARavis") << "create stream failed";
-			inited = false;
+			// the buffer arena is still allocated, startStream only hands it to the new stream
+			inited = startStream();
+			
+			watchdog.watch(camera);
 		}
 		
+		controlChannel.setFeatures(&features);
+		controlChannel.start();
+		if (recoveryPolling) startPoller();
 		return inited;
 	}
 
+	bool Grabber::saveProfile( std::string path ) {
+		if (!isInitialized()) return false;
+		FeatureTreeOptions options;
+		options.values = true;
+		FeatureTree tree = getFeatureTree( options );
+		ofJson profile = tree.toNestedJson();
+		profile["selected"] = ReadSelectorValues( features, tree ); // every entry of every selector, see ProfileToValues
+		return SaveProfile( path, profile );
+	}
+
+	ApplyResult Grabber::loadProfile( std::string path, bool rollback ) {
+		ofJson profile = LoadProfile( path );
+		if (profile.is_null()) return ApplyResult();
+		return applyProfile( profile, rollback );
+	}
+
+	ApplyResult Grabber::applyProfile( const ofJson & profile, bool rollback ) {
+		return applyFeatures( ProfileToValues( profile ), rollback );
+	}
+
 	int Grabber::getWidth() {
 		return initWidth;
 	}
 	int Grabber::getHeight() {
 		return initHeight;
 	}
+	int Grabber::getActiveWidth() {
+		return width;
+	}
+	int Grabber::getActiveHeight() {
+		return height;
+	}
 
 	int Grabber::getSensorWidth() { return sensorWidth; }
 	int Grabber::getSensorHeight() { return sensorHeight; }
 
 	bool Grabber::isInitialized() {
-		return camera;
+		return opened;
 	}
 
 	void Grabber::stop() {
+		// a reopen in progress finishes first, and one that failed leaves no camera behind
+		watchdog.stop();
 		if (!isInitialized()) return;
 		
 		ofLogNotice("ofxAravis") << "stopping...";
 		
-		arv_stream_set_emit_signals(stream, FALSE);
-		GError *err = nullptr;
-		arv_camera_stop_acquisition(camera, &err);
-		HandleError( err );
-		g_object_unref(stream);
-		g_object_unref(camera);
+		poller.stop();
+		poller.clear();
+		infoPolling = false;
+		controlChannel.stop();
+		stopStream();
+		
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		registers.setCamera(nullptr, nullptr);
+		features.setCamera(nullptr);
+		featureTree.clear();
+		if (camera) g_object_unref(camera);
+		camera = nullptr;
+		opened = false;
+		inited = false;
 		ofLogNotice("ofxAravis") << "stopped!";
 	}
 
 	void Grabber::setExposure(double exposure) {
-		if (!isInitialized())
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera)
 			return;
 		GError *err = nullptr;
 		
 		arv_camera_set_exposure_time_auto(camera, ARV_AUTO_OFF, &err);
 		HandleError( err );
+		registers.invalidate();
 		arv_camera_set_exposure_time(camera, exposure, &err);
 		HandleError( err );
 	}
@@ -850,13 +1183,11 @@ namespace ofxAravis {
 	}
 
 	Grabber::Clock::time_point Grabber::last_frame() {
-		mutex.lock();
-		auto p = p_last_frame;
-		mutex.unlock();
-		return p;
+		return Clock::time_point(Clock::duration(p_last_frame.load()));
 	}
 
 	double Grabber::getTemperature() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
 		if (!camera) return 0;
 		ArvDevice * dev = arv_camera_get_device(camera);
 		if (!dev) return 0;
@@ -871,6 +1202,8 @@ namespace ofxAravis {
 		const char *genicam_xml;
 		size_t size;
 		
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return "";
 		ArvDevice *dev = arv_camera_get_device(camera);
 		if (!dev) {
 			ofLogError("ofxAravis") << "Could not get device";
@@ -10,6 +10,29 @@
 #include "ofMain.h"
 #include "ofxOpenCv.h"
 
+#include "ofxAravis_discovery.h"
+#include "ofxAravis_frame.h"
+#include "ofxAravis_acquisition.h"
+#include "ofxAravis_buffers.h"
+#include "ofxAravis_mailbox.h"
+#include "ofxAravis_queue.h"
+#include "ofxAravis_workers.h"
+#include "ofxAravis_demosaic.h"
+#include "ofxAravis_convert.h"
+#include "ofxAravis_stats.h"
+#include "ofxAravis_features.h"
+#include "ofxAravis_poller.h"
+#include "ofxAravis_apply.h"
+#include "ofxAravis_profile.h"
+#include "ofxAravis_tree.h"
+#include "ofxAravis_cache.h"
+#include "ofxAravis_control.h"
+#include "ofxAravis_registers.h"
+#include "ofxAravis_sync.h"
+#include "ofxAravis_clock.h"
+#include "ofxAravis_watchdog.h"
+#include "ofxAravis_benchmark.h"
+
 //template<typename Type>
 //class Config{
 
@@ -38,17 +61,6 @@
 #include <chrono>
 
 namespace ofxAravis {
-    struct Device {
-        std::string id;
-        std::string physical_id;
-        std::string address;
-        std::string vendor;
-        std::string manufacturer_info;
-        std::string model;
-        std::string serial_nbr;
-        std::string protocol;
-    };
-
     struct Feature {
         std::string key;
         std::string value;
@@ -62,8 +74,7 @@ namespace ofxAravis {
         std::string todo;
     };
 
-    Device GetDeviceInfo( int idx );
-    std::vector<Device> ListAllDevices( bool print = true );
+    std::vector<Device> ListAllDevices( bool print = true ); // always scans, GetDiscoveryService().getDevices() for the cached list
     void HandleError( GError * err );
     std::vector<std::string> ArrayToVector( const char ** array, int length );
 
@@ -72,14 +83,33 @@ namespace ofxAravis {
             using Clock = std::chrono::high_resolution_clock;
             using BufferCallback = std::function<void(const cv::Mat&)>;
             void setBufferCallback(BufferCallback callback);
-            BufferCallback bufferCallback; // Store the callback function
+            BufferCallback bufferCallback; // Store the callback function, the cv::Mat is only valid during the call
+
+            void setFrameCallback(FrameCallback callback);
+            FrameCallback frameCallback; // Hold on to the lease to keep the frame
 
             Grabber();
             ~Grabber();
 
             void onAppExit(ofEventArgs& args);
             void setPixelFormat(ArvPixelFormat format);
+            void setAcquisitionSettings(AcquisitionSettings settings); // call before setup
+            void setBufferPoolSettings(BufferPoolSettings settings); // call before setup
+            void setQueueSettings(QueueSettings settings); // call before setup
+            QueueStats getQueueStats();
+            void setConversionWorkers(int workers); // 0 = convert on the stream thread, call before setup
+            void setWorkerPool(WorkerPool * pool); // convert on threads shared with other cameras instead, see CameraGroup, call before setup
+            void setGenicamCacheSettings(GenicamCacheSettings settings); // call before the first getFeatureTree
+
+            uint64_t getDroppedFrames(); // frame ids missing from the stream since setup
+            uint64_t getReceivedFrames();
+            guint64 getLastFrameId();
+            double getLatency(); // ms from the last packet arriving to the last frame being delivered
+            ClockModel & getClockModel(); // camera clock against the host, fitted from every frame
+            guint64 toHostTime(guint64 deviceTimestamp); // Frame::timestamp on the Frame::systemTimestamp clock
             bool setup(int targetCamera = 0, int targetX = -1, int targetY = -1, int targetWidth = -1, int targetHeight = -1, const char * targetPixelFormat = "");
+            bool setup(const Device & device, int targetX = -1, int targetY = -1, int targetWidth = -1, int targetHeight = -1, const char * targetPixelFormat = ""); // from ListAllDevices, no rescan, safe off the main thread
+            bool setup(const std::string & name, int targetX = -1, int targetY = -1, int targetWidth = -1, int targetHeight = -1, const char * targetPixelFormat = ""); // serial number, MAC, address or id, see DiscoveryService::find
             bool isInitialized();
             void stop();
         
@@ -95,19 +125,29 @@ namespace ofxAravis {
             bool update();
 
             void draw(int x=0, int y=0, int w=0, int h=0);
-            void drawInfo( int x = 10, int y = 20 );
+            void drawInfo( int x = 10, int y = 20 ); // reads cached state only, starts the poller on first use
+            FeaturePoller & getPoller(); // cached camera state, add your own entries or read drawInfo's
+
+            // callback on the poller thread whenever the feature's value changes, all subscriptions
+            // are read in one background cycle; they end when the camera stops
+            int subscribe( std::string key, double interval, FeaturePoller::Callback callback, double tolerance = 0 );
+            void unsubscribe( int id );
             Clock::time_point last_frame();
 
-            ArvCamera* camera;
-            ArvStream* stream;
+            ArvCamera* camera = nullptr; // replaced under the control lock when the watchdog reopens
+            ArvStream* stream = nullptr;
             std::vector<std::string> availableTriggerModes;
             std::vector<std::string> availableTriggerSources;
         
             ofTexture & getTexture();
+            FrameLease getFrame(); // latest frame taken by update(), no copy, call from the update thread
             int totalFrames;
         
             bool isInited();
         
+            // every call below that reaches the camera holds the FeatureCache control lock, so it
+            // never interleaves with polling, the control channel or register fast-path writes
+        
             // ------- EXPOSURE TIME -------
         
             bool hasExposureTime();
@@ -140,7 +180,9 @@ namespace ofxAravis {
         
             // ------- FEATURES -------
         
-            ofJson listAllFeatures();
+            ofJson listAllFeatures(); // nested, with values
+            // flat and indexed; structure only unless options.values, see FeatureTree
+            FeatureTree getFeatureTree( const FeatureTreeOptions & options = FeatureTreeOptions() );
         
             void setFeatureString( std::string key, std::string value );
             std::string getFeatureString( std::string key );
@@ -148,13 +190,59 @@ namespace ofxAravis {
             void setFeatureBoolean( std::string key, bool value );
             bool getFeatureBoolean( std::string key );
         
-            void setFeatureInteger( std::string key, int value );
-            int getFeatureInteger( std::string key );
+            void setFeatureInteger( std::string key, gint64 value );
+            gint64 getFeatureInteger( std::string key ); // -1 on error
             
-            void setFeatureFloat( std::string key, int value );
-            float getFeatureFloat( std::string key );
+            void setFeatureFloat( std::string key, double value );
+            double getFeatureFloat( std::string key ); // -1 on error
+
+            // any type at full precision, range checked before sending, see FeatureCache::set
+            template<typename T> bool setFeature( std::string key, const T & value, bool clamp = true ) {
+                GError *err = nullptr;
+                bool ok = features.set<T>( key, value, &err, clamp );
+                HandleError( err );
+                if (ok) registers.invalidate( key );
+                if (ok) poller.refresh( key );
+                return ok;
+            }
+            template<typename T> T getFeature( std::string key ) {
+                GError *err = nullptr;
+                T value = features.get<T>( key, &err );
+                HandleError( err );
+                return value;
+            }
         
             void executeCommand( std::string command );
+
+            // same calls on the control worker thread, see ControlChannel; repeated writes to a
+            // feature are merged, so these can be called every frame from a slider
+            std::future<ControlResult> setFeatureAsync( std::string key, ofJson value, ControlCallback callback = ControlCallback() );
+            std::future<ControlResult> getFeatureAsync( std::string key, ControlCallback callback = ControlCallback() );
+            std::future<ControlResult> executeCommandAsync( std::string command, ControlCallback callback = ControlCallback() );
+            ControlChannel & getControlChannel();
+
+            // opt-in direct register writes for features set every frame, see RegisterFastPath;
+            // setFeatureFast falls back to setFeature<double> when the feature didn't map
+            bool enableFastPath( std::string key );
+            void disableFastPath( std::string key );
+            bool setFeatureFast( std::string key, double value );
+            RegisterFastPath & getRegisterFastPath();
+        
+            // many features at once in dependency order, acquisition restarts if a locked one changes
+            ApplyResult applyFeatures( const ofJson & values, bool rollback = false );
+
+            // listAllFeatures() plus every selector entry to and from disk, loading writes only what differs, see ProfileToValues
+            bool saveProfile( std::string path );
+            ApplyResult loadProfile( std::string path, bool rollback = false );
+            ApplyResult applyProfile( const ofJson & profile, bool rollback = false );
+
+            // reopens the same device when control is lost or frames stop, reapplies the
+            // configuration captured when enabled plus later applyFeatures/applyProfile writes,
+            // and restarts the stream on the same buffers, see Watchdog. Call after setup.
+            void enableWatchdog( WatchdogSettings settings = WatchdogSettings() );
+            void disableWatchdog();
+            void captureConfiguration(); // again, after changing features some other way
+            Watchdog & getWatchdog();
         
             // ------- FPS -------
 
@@ -162,9 +250,8 @@ namespace ofxAravis {
             double getFPS();
             double getMinFPS();
             double getMaxFPS();
-            float getActualFPS();
-            float previousTimestamp;
-            float fpsTimeElapsed;
+            float getActualFPS(); // averaged over the stats window
+            StatsSnapshot getStats(); // fps, frame intervals, conversion, callback and latency percentiles, buffer statuses
         
             // ------- FORMATS -------
         
@@ -176,18 +263,23 @@ namespace ofxAravis {
         
             std::string getGenicamXML();
         
-            int getWidth();
+            int getWidth(); // the camera's default region, before setup applied the requested one
             int getHeight();
+            int getActiveWidth(); // the region frames arrive in
+            int getActiveHeight();
             
 
         private:
-            static void onNewBuffer(ArvStream * stream, Grabber * aravis);
-            void setPixels(cv::Mat& mat);
+            void onNewBuffer(ArvStream * stream, ArvBuffer * buffer);
+            void processFrame(FrameLease raw);
+            FrameLease convertFrame(FrameLease raw);
+            void deliverFrame(FrameLease out);
+            void setPixels(const FrameLease& lease);
+            bool startStream();
+            void stopStream();
 
             std::string safeConvertChars( const char * chars );
 
-            void loopThroughFeatures( ofJson & features, ArvGc * genicam, const char * feature, int level );
-            void processFeatureNode( ofJson & entry, ArvGcFeatureNode * node, int level );
             
             Device info;
             vector<std::string> formats;
@@ -197,15 +289,43 @@ namespace ofxAravis {
             int x, y, width, height; const char * pixelFormat; // dimensions reported back from API
             int w, h; // drawing width and height
             int sensorWidth, sensorHeight;
-            bool inited = false;
+            std::atomic<bool> inited { false };
+            std::atomic<bool> opened { false }; // camera is set, for checks that mustn't wait on the control lock
             ArvPixelFormat targetPixelFormat = ARV_PIXEL_FORMAT_BAYER_RG_8;
-            std::mutex mutex;
-            std::atomic_bool bFrameNew;
             ofImage image;
-            cv::Mat mat;
+            FramePool framePool;
+            Acquisition acquisition;
+            AcquisitionSettings acquisitionSettings;
+            BufferPool bufferPool;
+            BufferPoolSettings bufferPoolSettings { 100 };
+            FrameQueue frameQueue;
+            QueueSettings queueSettings;
+            ConversionPool conversionPool;
+            int conversionWorkers = 0;
+            WorkerPool * workerPool = nullptr;
+            Mailbox<FrameLease> mailbox; // stream thread -> update thread, never blocks either side
             ofImageType imageType;
             ArvBuffer *buffer;
-            Clock::time_point p_last_frame;
+            std::atomic<Clock::rep> p_last_frame;
+            FrameIdTracker frameIds;
+            ClockModel clock;
+            std::atomic<int64_t> latency { 0 }; // ns
+            StatsCollector stats;
+            FeatureCache features;
+            FeatureTree featureTree; // structure only, from the cache or built on first use
+            GenicamCache genicamCache;
+            FeaturePoller poller;
+            ControlChannel controlChannel;
+            RegisterFastPath registers;
+            Watchdog watchdog;
+            ofJson recoveryConfiguration; // feature values a reopen writes back, under the control lock
+            bool recoveryPolling = false; // the poller ran when the recovery in progress began
+            bool reopen( int attempt );
+            void startPoller();
+            void startInfoPolling();
+            bool infoPolling = false;
     };
 
 }
+
+#include "ofxAravis_group.h"
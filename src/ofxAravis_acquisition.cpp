@@ -0,0 +1,92 @@
+#include "ofxAravis_acquisition.h"
+
+namespace ofxAravis {
+
+	// ------- ACQUISITION -------
+
+	Acquisition::~Acquisition() {
+		stop();
+	}
+
+	void Acquisition::start( ArvStream * s, const AcquisitionSettings & st, BufferHandler h ) {
+
+		stop();
+
+		stream = s;
+		settings = st;
+		handler = h;
+		if (settings.batchSize < 1) settings.batchSize = 1;
+
+		wakes = 0;
+		buffers = 0;
+		running = true;
+
+		if (settings.mode == ACQUISITION_THREAD) {
+			thread = std::thread( &Acquisition::threadedFunction, this );
+		} else {
+			signalHandler = g_signal_connect( stream, "new-buffer", G_CALLBACK(onNewBuffer), this );
+			arv_stream_set_emit_signals( stream, TRUE );
+		}
+	}
+
+	void Acquisition::stop() {
+
+		if (!running) return;
+		running = false;
+
+		if (thread.joinable()) thread.join();
+
+		if (signalHandler) {
+			arv_stream_set_emit_signals( stream, FALSE );
+			g_signal_handler_disconnect( stream, signalHandler );
+			signalHandler = 0;
+		}
+
+		stream = nullptr;
+	}
+
+	bool Acquisition::isRunning() {
+		return running;
+	}
+
+	uint64_t Acquisition::getWakeCount() {
+		return wakes;
+	}
+
+	uint64_t Acquisition::getBufferCount() {
+		return buffers;
+	}
+
+	void Acquisition::onNewBuffer( ArvStream * stream, Acquisition * acquisition ) {
+
+		ArvBuffer * buffer = arv_stream_try_pop_buffer( stream );
+		if (buffer == nullptr) return;
+
+		acquisition->wakes += 1;
+		acquisition->buffers += 1;
+		acquisition->handler( stream, buffer );
+	}
+
+	void Acquisition::threadedFunction() {
+
+		while (running) {
+
+			// block until the first buffer is ready, then drain whatever else queued up behind it
+
+			ArvBuffer * buffer = arv_stream_timeout_pop_buffer( stream, settings.timeoutUs );
+			if (buffer == nullptr) continue;
+
+			wakes += 1;
+
+			int handled = 0;
+			while (buffer != nullptr) {
+				handler( stream, buffer );
+				buffers += 1;
+				handled += 1;
+				if (handled >= settings.batchSize || !running) break;
+				buffer = arv_stream_try_pop_buffer( stream );
+			}
+		}
+	}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <arv.h>
+
+#include <atomic>
+#include <thread>
+#include <functional>
+
+namespace ofxAravis {
+
+    // ------- ACQUISITION -------
+
+    // SIGNAL: one arv_stream_try_pop_buffer per "new-buffer" signal, on the Aravis stream thread.
+    // THREAD: our own worker loops on arv_stream_timeout_pop_buffer and drains every ready buffer per wake.
+
+    enum AcquisitionMode {
+        ACQUISITION_SIGNAL,
+        ACQUISITION_THREAD
+    };
+
+    struct AcquisitionSettings {
+        AcquisitionMode mode = ACQUISITION_SIGNAL;
+        guint64 timeoutUs = 100000; // how long the worker waits for a buffer before checking for stop
+        int batchSize = 16; // max buffers handled per wake
+    };
+
+    class Acquisition {
+        public:
+            // the handler owns the popped buffer and must push it back (or lease it)
+            using BufferHandler = std::function<void(ArvStream * stream, ArvBuffer * buffer)>;
+
+            ~Acquisition();
+
+            void start( ArvStream * stream, const AcquisitionSettings & settings, BufferHandler handler );
+            void stop();
+            bool isRunning();
+
+            uint64_t getWakeCount(); // signals or worker wake-ups that returned at least one buffer
+            uint64_t getBufferCount();
+
+        private:
+            static void onNewBuffer( ArvStream * stream, Acquisition * acquisition );
+            void threadedFunction();
+
+            ArvStream * stream = nullptr;
+            AcquisitionSettings settings;
+            BufferHandler handler;
+
+            gulong signalHandler = 0;
+            std::thread thread;
+            std::atomic_bool running { false };
+            std::atomic<uint64_t> wakes { 0 };
+            std::atomic<uint64_t> buffers { 0 };
+    };
+
+}
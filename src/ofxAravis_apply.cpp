@@ -0,0 +1,282 @@
+#include "ofxAravis_apply.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ofxAravis {
+
+	namespace {
+
+		struct Write {
+			std::string name;
+			ofJson value;
+			FeatureHandlePtr handle;
+			ofJson current;
+			int segment = 0;
+			int rank = 0;
+			bool changed = true;
+			bool deferred = false; // compared when written, a selector before it changes what it reads
+		};
+
+		bool endsWith( const std::string & name, const std::string & suffix ) {
+			return name.size() >= suffix.size() && name.compare( name.size() - suffix.size(), suffix.size(), suffix ) == 0;
+		}
+
+		bool startsWith( const std::string & name, const std::string & prefix ) {
+			return name.compare( 0, prefix.size(), prefix ) == 0;
+		}
+
+		bool isSelector( const FeatureHandle & handle ) {
+			return ARV_IS_GC_SELECTOR( handle.node ) && arv_gc_selector_is_selector( ARV_GC_SELECTOR( handle.node ) );
+		}
+
+		bool isOff( const ofJson & value ) {
+			return (value.is_string() && value.get<std::string>() == "Off") || (value.is_boolean() && !value.get<bool>());
+		}
+
+		bool matches( const FeatureHandle & handle, const ofJson & current, const ofJson & value ) {
+			if (current.is_null() || handle.type == FEATURE_COMMAND) return false;
+			if (handle.type == FEATURE_FLOAT && value.is_number()) {
+				double a = current.get<double>();
+				double b = value.get<double>();
+				// profiles written by listAllFeatures hold floats at single precision
+				double tolerance = std::max( handle.increment / 2, std::abs( b ) * 1e-6 );
+				return std::abs( a - b ) <= tolerance;
+			}
+			if (handle.type == FEATURE_INTEGER && value.is_number()) return current.get<gint64>() == gint64( std::llround( value.get<double>() ) );
+			if (handle.type == FEATURE_BOOLEAN && value.is_number_integer()) return current.get<bool>() == (value.get<int>() != 0);
+			return current == value;
+		}
+
+		// lower ranks are written first within a segment
+
+		int rankOf( const Write & write ) {
+
+			const std::string & name = write.name;
+
+			if (isSelector( *write.handle )) return 0;
+			if (endsWith( name, "Enable" )) return 1;
+			if (endsWith( name, "Auto" )) return isOff( write.value ) ? 1 : 7;
+			if (name == "PixelFormat" || startsWith( name, "Binning" ) || startsWith( name, "Decimation" )) return 2;
+
+			if (name == "OffsetX" || name == "OffsetY") {
+				// a smaller offset never fails, a larger one might until the size has shrunk
+				bool shrinking = write.current.is_number() && write.value.is_number() && write.value.get<double>() < write.current.get<double>();
+				return shrinking ? 3 : 5;
+			}
+			if (name == "Width" || name == "Height") return 4;
+			if (write.handle->type == FEATURE_COMMAND) return 8;
+			return 6;
+		}
+
+		void addResult( ApplyResult & result, const std::string & name, ApplyStatus status, const ofJson & value, const ofJson & previous, const std::string & message = "" ) {
+			ApplyFeatureResult entry;
+			entry.name = name;
+			entry.status = status;
+			entry.value = value;
+			entry.previous = previous;
+			entry.message = message;
+			result.features.push_back( entry );
+		}
+
+	}
+
+	ApplyResult ApplyFeatures( FeatureCache & cache, const ofJson & values, const ApplyOptions & options ) {
+
+		ApplyResult result;
+
+		// the whole batch holds the control lock, background reads see it before or after
+
+		std::unique_lock<std::recursive_mutex> control( cache.getControlMutex() );
+
+		// ------- PLAN -------
+
+		std::vector<std::pair<std::string, ofJson>> requested;
+		if (values.is_array()) {
+			for (auto & item : values) {
+				if (!item.is_object()) continue;
+				for (auto it = item.begin(); it != item.end(); ++it) requested.emplace_back( it.key(), it.value() );
+			}
+		} else if (values.is_object()) {
+			for (auto it = values.begin(); it != values.end(); ++it) requested.emplace_back( it.key(), it.value() );
+		}
+
+		std::vector<Write> writes;
+		int segment = 0;
+		bool afterSelector = false;
+
+		for (auto & request : requested) {
+
+			Write write;
+			write.name = request.first;
+			write.value = request.second;
+			write.handle = cache.resolve( write.name );
+
+			if (!write.handle) {
+				addResult( result, write.name, APPLY_UNKNOWN, write.value, nullptr, "no such feature" );
+				continue;
+			}
+
+			// in array form every selector starts a new segment, so the writes after it go to what it selects
+			if (values.is_array() && isSelector( *write.handle ) && !writes.empty()) segment += 1;
+			write.segment = segment;
+			write.deferred = values.is_array() && afterSelector;
+			if (values.is_array() && isSelector( *write.handle )) afterSelector = true;
+
+			if (!write.deferred) {
+				GError * err = nullptr;
+				if (write.handle->type != FEATURE_COMMAND) write.current = cache.getValue( write.name, &err );
+				g_clear_error( &err );
+				write.changed = !matches( *write.handle, write.current, write.value );
+			}
+			write.rank = rankOf( write );
+			writes.push_back( write );
+		}
+
+		std::stable_sort( writes.begin(), writes.end(), []( const Write & a, const Write & b ) {
+			return a.segment != b.segment ? a.segment < b.segment : a.rank < b.rank;
+		});
+
+		// ------- PAUSE -------
+
+		// features behind TLParamsLocked (size, format...) can only change while not acquiring
+
+		if (options.streaming && options.pause) {
+			for (auto & write : writes) {
+				if (!write.changed) continue;
+				GError * err = nullptr;
+				bool locked = arv_gc_feature_node_is_locked( ARV_GC_FEATURE_NODE( write.handle->node ), &err );
+				g_clear_error( &err );
+				if (locked) {
+					// pause joins the frame threads, a frame callback may be waiting for this lock
+					control.unlock();
+					options.pause();
+					control.lock();
+					result.restarted = true;
+					break;
+				}
+			}
+		}
+
+		// ------- WRITE -------
+
+		bool failed = false;
+		std::vector<size_t> written;
+
+		for (auto & write : writes) {
+
+			if (failed && options.rollback) {
+				addResult( result, write.name, APPLY_FAILED, write.value, write.current, "not attempted after an earlier failure" );
+				continue;
+			}
+
+			if (write.deferred && write.handle->type != FEATURE_COMMAND) {
+				GError * err = nullptr;
+				write.current = cache.getValue( write.name, &err );
+				g_clear_error( &err );
+				write.changed = !matches( *write.handle, write.current, write.value );
+			}
+
+			if (!write.changed) {
+				addResult( result, write.name, APPLY_UNCHANGED, write.value, write.current );
+				continue;
+			}
+
+			if (!write.handle->isWritable()) {
+				GError * err = nullptr;
+				bool locked = arv_gc_feature_node_is_locked( ARV_GC_FEATURE_NODE( write.handle->node ), &err );
+				g_clear_error( &err );
+				if (!locked) {
+					addResult( result, write.name, APPLY_READ_ONLY, write.value, write.current, "read only" );
+					failed = true;
+					continue;
+				}
+			}
+
+			GError * err = nullptr;
+			bool ok = cache.setValue( write.name, write.value, &err );
+
+			if (err) {
+				addResult( result, write.name, APPLY_FAILED, write.value, write.current, err->message );
+				g_clear_error( &err );
+				failed = true;
+			} else if (!ok) {
+				addResult( result, write.name, APPLY_INVALID, write.value, write.current, "value doesn't fit a " + FeatureTypeToString( write.handle->type ) + " feature" );
+				failed = true;
+			} else {
+				addResult( result, write.name, APPLY_WRITTEN, write.value, write.current );
+				written.push_back( result.features.size() - 1 );
+			}
+		}
+
+		// ------- ROLLBACK -------
+
+		if (failed && options.rollback) {
+			for (auto it = written.rbegin(); it != written.rend(); ++it) {
+				ApplyFeatureResult & entry = result.features[*it];
+				if (entry.previous.is_null()) continue;
+				GError * err = nullptr;
+				cache.setValue( entry.name, entry.previous, &err );
+				if (err) {
+					entry.message = std::string( "rollback failed: " ) + err->message;
+					g_clear_error( &err );
+				} else {
+					entry.status = APPLY_REVERTED;
+				}
+			}
+		}
+
+		// bounds of numeric features can depend on what was just written (Width max after binning),
+		// they are re-read on the next checked write of each
+
+		cache.invalidateBounds();
+
+		// ------- RESUME -------
+
+		if (result.restarted && options.resume && !options.resume()) {
+			ofLogError("ofxAravis") << "ApplyFeatures: acquisition did not restart";
+		}
+
+		for (auto & entry : result.features) {
+			if (entry.status == APPLY_WRITTEN) result.written += 1;
+			else if (entry.status == APPLY_UNCHANGED) result.unchanged += 1;
+			else result.failed += 1;
+		}
+
+		return result;
+	}
+
+	std::string ApplyStatusToString( ApplyStatus status ) {
+		switch (status) {
+			case APPLY_WRITTEN: return "written";
+			case APPLY_UNCHANGED: return "unchanged";
+			case APPLY_FAILED: return "failed";
+			case APPLY_UNKNOWN: return "unknown";
+			case APPLY_READ_ONLY: return "readOnly";
+			case APPLY_INVALID: return "invalid";
+			case APPLY_REVERTED: return "reverted";
+			default: return "unknown";
+		}
+	}
+
+	ofJson ApplyResult::toJson() const {
+		ofJson json;
+		json["ok"] = ok();
+		json["restarted"] = restarted;
+		json["written"] = written;
+		json["unchanged"] = unchanged;
+		json["failed"] = failed;
+		json["features"] = ofJson::array();
+		for (auto & entry : features) {
+			ofJson item;
+			item["name"] = entry.name;
+			item["status"] = ApplyStatusToString( entry.status );
+			item["value"] = entry.value;
+			if (!entry.previous.is_null()) item["previous"] = entry.previous;
+			if (!entry.message.empty()) item["message"] = entry.message;
+			json["features"].push_back( item );
+		}
+		return json;
+	}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ofxAravis_features.h"
+
+#include <vector>
+#include <functional>
+
+namespace ofxAravis {
+
+    // ------- APPLY FEATURES -------
+
+    // Writes many features in one pass, in an order that avoids the usual GenICam traps:
+    // selectors first, auto modes switched off before their value and on after it, PixelFormat,
+    // binning and decimation before Width/Height, offsets shrunk before the size grows and
+    // raised after it. Values that already match are not written.
+    //
+    // values is either an object { "Width": 1024, "PixelFormat": "BayerRG8" }, or an array of
+    // single-key objects when the order of writes to the same selector matters:
+    // [ { "GainSelector": "DigitalAll" }, { "Gain": 2 }, { "GainSelector": "AnalogAll" }, { "Gain": 6 } ]
+
+    enum ApplyStatus {
+        APPLY_WRITTEN,
+        APPLY_UNCHANGED, // already had the value, nothing sent
+        APPLY_FAILED, // the device refused the write
+        APPLY_UNKNOWN, // the camera has no such feature
+        APPLY_READ_ONLY,
+        APPLY_INVALID, // value doesn't fit the feature type
+        APPLY_REVERTED // written, then restored after a later failure (ApplyOptions::rollback)
+    };
+
+    struct ApplyFeatureResult {
+        std::string name;
+        ApplyStatus status = APPLY_UNCHANGED;
+        ofJson value; // requested
+        ofJson previous; // read before writing
+        std::string message;
+    };
+
+    struct ApplyResult {
+        std::vector<ApplyFeatureResult> features; // in the order they were applied
+        bool restarted = false; // acquisition was stopped for features locked while streaming
+        int written = 0;
+        int unchanged = 0;
+        int failed = 0;
+
+        bool ok() const { return failed == 0; }
+        ofJson toJson() const;
+    };
+
+    struct ApplyOptions {
+        bool streaming = false;
+        // stops acquisition, called only if a changed feature is locked and without the control
+        // lock, so callers that set it must not hold that lock around ApplyFeatures
+        std::function<void()> pause;
+        std::function<bool()> resume; // restarts acquisition, buffers must follow a payload change
+        bool rollback = false; // on any failure restore every feature written so far, newest first
+    };
+
+    ApplyResult ApplyFeatures( FeatureCache & cache, const ofJson & values, const ApplyOptions & options = ApplyOptions() );
+
+    std::string ApplyStatusToString( ApplyStatus status );
+
+}
@@ -0,0 +1,242 @@
+#include "ofxAravis_benchmark.h"
+#include "ofxAravis_demosaic.h"
+#include "ofxOpenCv.h"
+
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+namespace ofxAravis {
+
+	// ------- BENCHMARKS -------
+
+	template<typename Function>
+	static double TimeMs( int iterations, Function function ) {
+		function(); // warm up caches and pages
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++) function();
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>( end - start ).count() / iterations;
+	}
+
+	static const char * BayerPatternToString( BayerPattern pattern ) {
+		switch (pattern) {
+			case BAYER_RG: return "RG";
+			case BAYER_GB: return "GB";
+			case BAYER_GR: return "GR";
+			default: return "BG";
+		}
+	}
+
+	// every kernel against DemosaicReference for every pattern, depth and output. The odd size
+	// leaves a partial vector at the end of each row and mirrored borders on all four sides
+
+	static ofJson CheckDemosaicExact( const std::vector<DemosaicKernel> & kernels ) {
+
+		const int w = 67;
+		const int h = 37;
+		std::mt19937 random( 2 );
+
+		ofJson results;
+		ofJson failures = ofJson::array();
+
+		for (int bitDepth : { 8, 10, 12, 16 }) {
+
+			int bytes = bitDepth == 8 ? 1 : 2;
+			std::vector<uint8_t> bayer( size_t(w) * h * bytes );
+			if (bytes == 1) {
+				for (auto & sample : bayer) sample = uint8_t( random() );
+			} else {
+				uint16_t * samples = reinterpret_cast<uint16_t *>( bayer.data() );
+				for (int i = 0; i < w * h; i++) samples[i] = uint16_t( random() & ((1u << bitDepth) - 1) );
+			}
+
+			std::vector<uint8_t> reference8( size_t(w) * h * 3 ), rgb8( reference8.size() );
+			std::vector<uint16_t> reference16( size_t(w) * h * 3 ), rgb16( reference16.size() );
+
+			for (BayerPattern pattern : { BAYER_RG, BAYER_GB, BAYER_GR, BAYER_BG }) {
+
+				DemosaicReference( bayer.data(), w * bytes, w, h, bitDepth, pattern, reference8.data(), w * 3, false );
+				DemosaicReference( bayer.data(), w * bytes, w, h, bitDepth, pattern, reference16.data(), w * 6, true );
+
+				for (auto kernel : kernels) {
+					std::fill( rgb8.begin(), rgb8.end(), 0 );
+					std::fill( rgb16.begin(), rgb16.end(), 0 );
+					DemosaicRGB8( bayer.data(), w * bytes, w, h, bitDepth, pattern, rgb8.data(), w * 3, kernel );
+					DemosaicRGB16( bayer.data(), w * bytes, w, h, bitDepth, pattern, rgb16.data(), w * 6, kernel );
+
+					std::string name = std::string( BayerPatternToString( pattern ) ) + ofToString( bitDepth ) + " " + DemosaicKernelToString( kernel );
+					bool exact8 = rgb8 == reference8;
+					bool exact16 = rgb16 == reference16;
+					results[name]["rgb8"] = exact8;
+					results[name]["rgb16"] = exact16;
+
+					if (!exact8) failures.push_back( name + " rgb8" );
+					if (!exact16) failures.push_back( name + " rgb16" );
+					if (!exact8 || !exact16) ofLogError("ofxAravis") << "BenchmarkDemosaic: " << name << " differs from the reference" << (exact8 ? "" : " in rgb8") << (exact16 ? "" : " in rgb16");
+				}
+			}
+		}
+
+		results["failures"] = failures;
+		return results;
+	}
+
+	ofJson BenchmarkDemosaic( int iterations ) {
+
+		struct Resolution { std::string name; int width; int height; };
+		std::vector<Resolution> resolutions = {
+			{ "1080p", 1920, 1080 },
+			{ "5MP", 2448, 2048 },
+			{ "9MP", 4200, 2160 }
+		};
+
+		std::vector<DemosaicKernel> kernels = { DEMOSAIC_SCALAR };
+		if (GetDemosaicKernel() >= DEMOSAIC_SSE41) kernels.push_back( DEMOSAIC_SSE41 );
+		if (GetDemosaicKernel() >= DEMOSAIC_AVX2) kernels.push_back( DEMOSAIC_AVX2 );
+
+		int threads = cv::getNumThreads();
+		cv::setNumThreads( 1 );
+
+		ofJson results;
+		results["exactness"] = CheckDemosaicExact( kernels );
+		std::mt19937 random( 1 );
+
+		for (auto & resolution : resolutions) {
+
+			int w = resolution.width;
+			int h = resolution.height;
+			double megapixels = double(w) * h / 1e6;
+
+			cv::Mat bayer( h, w, CV_8UC1 );
+			for (int i = 0; i < w * h; i++) bayer.data[i] = uint8_t( random() );
+
+			cv::Mat reference( h, w, CV_8UC3 );
+			cv::Mat rgb( h, w, CV_8UC3 );
+			DemosaicReference( bayer.data, w, w, h, 8, BAYER_RG, reference.data, w * 3, false );
+
+			ofJson entry;
+			entry["width"] = w;
+			entry["height"] = h;
+
+			for (auto kernel : kernels) {
+				double ms = TimeMs( iterations, [&] {
+					DemosaicRGB8( bayer.data, w, w, h, 8, BAYER_RG, rgb.data, w * 3, kernel );
+				});
+				std::string name = DemosaicKernelToString( kernel );
+				entry[name]["ms"] = ms;
+				entry[name]["mpixPerSecond"] = megapixels / (ms / 1000.0);
+				entry[name]["exact"] = std::equal( rgb.data, rgb.data + size_t(w) * h * 3, reference.data );
+			}
+
+			// what Grabber used before, OpenCV names Bayer patterns one cell over so this yields RGB
+			double ms = TimeMs( iterations, [&] {
+				cv::cvtColor( bayer, rgb, CV_BayerRG2BGR );
+			});
+			entry["opencv"]["ms"] = ms;
+			entry["opencv"]["mpixPerSecond"] = megapixels / (ms / 1000.0);
+
+			results[resolution.name] = entry;
+		}
+
+		cv::setNumThreads( threads );
+
+		ofLogNotice("ofxAravis") << "BenchmarkDemosaic: " << results.dump(4);
+		return results;
+	}
+
+	static ofJson WriteLatency( int iterations, const std::function<bool( int )> & write ) {
+
+		std::vector<double> us;
+		us.reserve( iterations );
+		int failed = 0;
+
+		write( 0 ); // warm up node and socket
+		for (int i = 0; i < iterations; i++) {
+			auto start = std::chrono::steady_clock::now();
+			if (!write( i )) failed += 1;
+			auto end = std::chrono::steady_clock::now();
+			us.push_back( std::chrono::duration<double, std::micro>( end - start ).count() );
+		}
+
+		ofJson json;
+		json["failed"] = failed;
+		if (us.empty()) return json;
+
+		double sum = 0;
+		for (double t : us) sum += t;
+		std::sort( us.begin(), us.end() );
+		json["meanUs"] = sum / us.size();
+		json["p50Us"] = us[us.size() / 2];
+		json["p99Us"] = us[std::min( us.size() - 1, us.size() * 99 / 100 )];
+		return json;
+	}
+
+	ofJson BenchmarkFeatureWrites( ArvCamera * camera, FeatureCache & features, RegisterFastPath & registers, const std::string & feature, int iterations ) {
+
+		ofJson results;
+		results["feature"] = feature;
+		results["iterations"] = iterations;
+
+		FeatureHandlePtr handle = features.resolve( feature );
+		if (!camera || !handle || handle->type != FEATURE_FLOAT) {
+			ofLogError("ofxAravis") << "BenchmarkFeatureWrites: " << feature << " is not a float feature";
+			return results;
+		}
+
+		GError * err = nullptr;
+		double original = features.get<double>( feature, &err );
+		g_clear_error( &err );
+
+		// two values close to the original, so the camera doesn't visibly jump
+		double step = std::max( handle->increment, std::abs( original ) * 0.01 );
+		double a = original;
+		double b = original + step <= handle->max ? original + step : original - step;
+		if (handle->hasBounds) {
+			a = std::min( std::max( a, handle->min ), handle->max );
+			b = std::min( std::max( b, handle->min ), handle->max );
+		}
+
+		results["camera"] = WriteLatency( iterations, [&]( int i ) {
+			GError * e = nullptr;
+			arv_camera_set_float( camera, feature.c_str(), i % 2 ? b : a, &e );
+			bool ok = e == nullptr;
+			g_clear_error( &e );
+			return ok;
+		});
+
+		results["featureCache"] = WriteLatency( iterations, [&]( int i ) {
+			GError * e = nullptr;
+			bool ok = features.set<double>( feature, i % 2 ? b : a, &e );
+			g_clear_error( &e );
+			return ok;
+		});
+
+		if (!registers.isFast( feature )) registers.enable( feature );
+		RegisterMapping mapping = registers.getMapping( feature );
+		results["registerMapped"] = mapping.fast;
+		results["registerWritable"] = mapping.writable;
+
+		// mapped but locked would time the node path it falls back to
+		if (mapping.fast && mapping.writable) {
+			results["register"] = WriteLatency( iterations, [&]( int i ) {
+				GError * e = nullptr;
+				bool ok = registers.set( feature, i % 2 ? b : a, &e );
+				g_clear_error( &e );
+				return ok;
+			});
+			results["register"]["address"] = mapping.address;
+			results["register"]["length"] = mapping.length;
+		} else {
+			results["registerReason"] = mapping.reason;
+		}
+
+		// through the node, so Aravis drops anything it cached while the register changed under it
+		features.set<double>( feature, original, &err );
+		g_clear_error( &err );
+
+		ofLogNotice("ofxAravis") << "BenchmarkFeatureWrites: " << results.dump(4);
+		return results;
+	}
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxAravis_registers.h"
+
+namespace ofxAravis {
+
+    // ------- BENCHMARKS -------
+
+    // Demosaic throughput of every kernel this CPU supports against cv::cvtColor,
+    // single threaded, at 1080p, 5 MP and 9 MP. Each kernel is also checked bit for bit against
+    // DemosaicReference for every pattern, 8/10/12/16-bit input and RGB8/RGB16 output; mismatches
+    // are logged and listed in ["exactness"]["failures"].
+    ofJson BenchmarkDemosaic( int iterations = 10 );
+
+    // Per write latency of a float feature through arv_camera_set_float, FeatureCache::set and
+    // the register fast path (when the feature maps), alternating between two in range values.
+    // Reports mean, p50 and p99 in microseconds and restores the value it found.
+    ofJson BenchmarkFeatureWrites( ArvCamera * camera, FeatureCache & features, RegisterFastPath & registers, const std::string & feature = "ExposureTime", int iterations = 200 );
+
+}
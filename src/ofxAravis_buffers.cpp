@@ -0,0 +1,204 @@
+#include "ofxAravis_buffers.h"
+#include "ofMain.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace ofxAravis {
+
+	// ------- BUFFER POOL -------
+
+	static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	static size_t roundUp( size_t value, size_t multiple ) {
+		return ((value + multiple - 1) / multiple) * multiple;
+	}
+
+	BufferArena::~BufferArena() {
+		if (locked) munlock( memory, size );
+		if (!external) munmap( memory, size );
+	}
+
+	static void releaseArenaRef( gpointer data ) {
+		delete static_cast<std::shared_ptr<BufferArena> *>( data );
+	}
+
+	std::shared_ptr<BufferArena> ArenaOf( ArvBuffer * buffer ) {
+		void * data = arv_buffer_get_user_data( buffer );
+		if (!data) return nullptr;
+		return *static_cast<std::shared_ptr<BufferArena> *>( data );
+	}
+
+	BufferPool::~BufferPool() {
+		release();
+	}
+
+	bool BufferPool::allocate( size_t p, const BufferPoolSettings & settings ) {
+
+		size_t pageSize = size_t( sysconf( _SC_PAGESIZE ) );
+		size_t slot = roundUp( p, pageSize );
+		int n = settings.count < 1 ? 1 : settings.count;
+
+		// caller's memory: adopt it once, then it either fits or there is nothing to fall back to
+
+		if (settings.memory) {
+			if (!adopted || adopted->memory != settings.memory) {
+				if (!allocate( settings.memory, settings.memoryBytes )) return false;
+			}
+			if (slot * n > adopted->size) {
+				ofLogError("ofxAravis") << "BufferPool: " << n << " x " << slot << " bytes don't fit the supplied " << adopted->size << " bytes";
+				return false;
+			}
+			if (adopted->leases == 0) {
+				arena = adopted;
+				payload = p;
+				slotSize = slot;
+				count = n;
+				return true;
+			}
+
+			// frames from the caller's memory are still held, a mapped arena stands in until they return
+
+			ofLogWarning("ofxAravis") << "BufferPool: " << adopted->leases << " frames from the supplied memory are still held, mapping a temporary arena";
+			BufferPoolSettings mapped = settings;
+			mapped.memory = nullptr;
+			mapped.memoryBytes = 0;
+			if (!map( slot * n, mapped )) return false;
+			payload = p;
+			slotSize = slot;
+			count = n;
+			return true;
+		}
+		if (adopted) release();
+
+		// reuse the arena across stop/start when it still fits and nothing leased from it is held
+
+		if (arena && arena->leases == 0 && slot * n <= arena->size && settings.hugePages == requested.hugePages && settings.lockMemory == requested.lockMemory) {
+			payload = p;
+			slotSize = slot;
+			count = n;
+			return true;
+		}
+
+		if (arena && arena->leases > 0) {
+			ofLogNotice("ofxAravis") << "BufferPool: " << arena->leases << " frames are still held, mapping a fresh arena";
+		}
+		if (!map( slot * n, settings )) return false;
+
+		payload = p;
+		slotSize = slot;
+		count = n;
+
+		ofLogNotice("ofxAravis") << "BufferPool: " << count << " x " << payload << " bytes" << (arena->huge ? " (huge pages)" : "") << (arena->locked ? " (locked)" : "");
+		return true;
+	}
+
+	bool BufferPool::map( size_t size, const BufferPoolSettings & settings ) {
+
+		// the old arena is retired here, it stays mapped until its buffers and leases are gone
+
+		arena.reset();
+		slotSize = 0;
+		payload = 0;
+		count = 0;
+		requested = settings;
+
+		size_t pageSize = size_t( sysconf( _SC_PAGESIZE ) );
+		void * memory = MAP_FAILED;
+		bool huge = false;
+
+#ifdef MAP_HUGETLB
+		if (settings.hugePages) {
+			size_t hugeSize = roundUp( size, HUGE_PAGE_SIZE );
+			memory = mmap( nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+			if (memory != MAP_FAILED) {
+				size = hugeSize;
+				huge = true;
+			} else {
+				ofLogWarning("ofxAravis") << "BufferPool: huge pages unavailable, using normal pages";
+			}
+		}
+#else
+		if (settings.hugePages) ofLogWarning("ofxAravis") << "BufferPool: huge pages not supported on this platform";
+#endif
+
+		if (memory == MAP_FAILED) {
+			memory = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		}
+		if (memory == MAP_FAILED) {
+			ofLogError("ofxAravis") << "BufferPool: could not map " << size << " bytes";
+			return false;
+		}
+
+		arena = std::make_shared<BufferArena>();
+		arena->memory = static_cast<uint8_t *>( memory );
+		arena->size = size;
+		arena->huge = huge;
+
+		if (settings.lockMemory) {
+			if (mlock( arena->memory, arena->size ) == 0) {
+				arena->locked = true;
+			} else {
+				ofLogWarning("ofxAravis") << "BufferPool: mlock failed, check RLIMIT_MEMLOCK";
+			}
+		}
+
+		if (settings.prefault) {
+			for (size_t i = 0; i < arena->size; i += pageSize) arena->memory[i] = 0;
+		}
+		return true;
+	}
+
+	bool BufferPool::allocate( void * memory, size_t bytes ) {
+
+		size_t pageSize = size_t( sysconf( _SC_PAGESIZE ) );
+		if (!memory || bytes == 0) {
+			ofLogError("ofxAravis") << "BufferPool: no memory supplied";
+			return false;
+		}
+		if (reinterpret_cast<uintptr_t>( memory ) % pageSize != 0) {
+			ofLogError("ofxAravis") << "BufferPool: supplied memory is not aligned to the " << pageSize << " byte page size";
+			return false;
+		}
+
+		release();
+		adopted = std::make_shared<BufferArena>();
+		adopted->memory = static_cast<uint8_t *>( memory );
+		adopted->size = bytes;
+		adopted->external = true;
+		arena = adopted;
+		return true;
+	}
+
+	void BufferPool::push( ArvStream * stream ) {
+
+		// the stream owns the ArvBuffer objects, each one holds a reference to the arena that owns the memory
+
+		for (int i = 0; i < count; i++) {
+			ArvBuffer * buffer = arv_buffer_new_full( payload, arena->memory + slotSize * i, new std::shared_ptr<BufferArena>( arena ), releaseArenaRef );
+			arv_stream_push_buffer( stream, buffer );
+		}
+	}
+
+	void BufferPool::release() {
+
+		// only drops the pool's reference, buffers and leases still pointing into the arena keep it mapped
+
+		arena.reset();
+		adopted.reset();
+		slotSize = 0;
+		payload = 0;
+		count = 0;
+	}
+
+	bool BufferPool::isAllocated() { return arena != nullptr; }
+	size_t BufferPool::getPayload() { return payload; }
+	size_t BufferPool::getSlotSize() { return slotSize; }
+	size_t BufferPool::getArenaSize() { return arena ? arena->size : 0; }
+	int BufferPool::getCount() { return count; }
+	bool BufferPool::isHugePages() { return arena && arena->huge; }
+	bool BufferPool::isLocked() { return arena && arena->locked; }
+	bool BufferPool::isExternal() { return arena && arena->external; }
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <arv.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <atomic>
+
+namespace ofxAravis {
+
+    // ------- BUFFER POOL -------
+
+    struct BufferPoolSettings {
+        int count = 8; // buffers handed to the stream, each one payload in size
+        bool hugePages = false; // back the arena with huge pages where available, falls back to normal pages
+        bool lockMemory = false; // mlock the arena so it can't be paged out
+        bool prefault = true; // touch every page on allocation so the first frames don't page fault
+        void * memory = nullptr; // caller-owned, page-aligned arena to use instead of mapping one, see allocate( memory, bytes )
+        size_t memoryBytes = 0;
+    };
+
+    // The memory behind a pool's slots. Every ArvBuffer pushed from it and every lease on one of
+    // those buffers holds a reference, so it is only unmapped once the last of them is gone.
+
+    struct BufferArena {
+        uint8_t * memory = nullptr;
+        size_t size = 0;
+        bool huge = false;
+        bool locked = false;
+        bool external = false;
+        std::atomic<int> leases { 0 }; // frames leased from this arena and not yet returned
+        ~BufferArena();
+    };
+
+    // The arena a buffer's data points into, null for buffers that didn't come from a BufferPool.
+
+    std::shared_ptr<BufferArena> ArenaOf( ArvBuffer * buffer );
+
+    // One contiguous, page-aligned arena carved into stream buffers. The arena
+    // outlives the stream so it is reused across stop/start when the payload still fits
+    // and no frame leased from it is still held; otherwise a fresh arena is mapped and the
+    // old one is retired when its last lease returns.
+    // The arena can also be the caller's memory (pinned, shared, NUMA-placed...): it has to be page
+    // aligned and outlive the pool, and is never unmapped or locked here. While frames from it are
+    // still held the pool maps its own arena instead, and goes back to the caller's on the next allocate.
+
+    class BufferPool {
+        public:
+            ~BufferPool();
+
+            bool allocate( size_t payload, const BufferPoolSettings & settings );
+            bool allocate( void * memory, size_t bytes ); // adopt the caller's arena, slots are carved on the next allocate
+            void push( ArvStream * stream );
+            void release();
+
+            bool isAllocated();
+            size_t getPayload();
+            size_t getSlotSize();
+            size_t getArenaSize();
+            int getCount();
+            bool isHugePages();
+            bool isLocked();
+            bool isExternal();
+
+        private:
+            bool map( size_t size, const BufferPoolSettings & settings );
+
+            std::shared_ptr<BufferArena> arena; // the one slots are carved from
+            std::shared_ptr<BufferArena> adopted; // the caller's, kept while a mapped arena stands in for it
+            size_t slotSize = 0;
+            size_t payload = 0;
+            int count = 0;
+            BufferPoolSettings requested;
+    };
+
+}
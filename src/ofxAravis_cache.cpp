@@ -0,0 +1,182 @@
+#include "ofxAravis_cache.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <mutex>
+
+namespace ofxAravis {
+
+	namespace {
+
+		const int INDEX_VERSION = 2; // bump when FeatureTree::toJson changes shape
+
+		// cameras of one model opened in parallel would otherwise share the temporary files
+		std::mutex storeMutex;
+
+		std::string sanitize( const std::string & text ) {
+			std::string out;
+			out.reserve( text.size() );
+			for (char c : text) out += (isalnum( (unsigned char) c ) || c == '-' || c == '.') ? c : '_';
+			return out;
+		}
+
+		// FNV-1a, only has to tell two XML revisions of the same model apart
+		std::string hashOf( const std::string & text ) {
+			uint64_t hash = 14695981039346656037ULL;
+			for (unsigned char c : text) {
+				hash ^= c;
+				hash *= 1099511628211ULL;
+			}
+			char out[17];
+			snprintf( out, sizeof( out ), "%016llx", (unsigned long long) hash );
+			return out;
+		}
+
+		std::string readString( FeatureCache & features, const std::string & name ) {
+			if (!features.resolve( name )) return "";
+			GError * err = nullptr;
+			std::string value = features.getString( name, &err );
+			g_clear_error( &err );
+			return value;
+		}
+
+	}
+
+	// ------- GENICAM CACHE -------
+
+	std::string GenicamModelKey::toString() const {
+		return sanitize( vendor ) + "_" + sanitize( model ) + "_" + sanitize( firmware );
+	}
+
+	GenicamModelKey GetGenicamModelKey( FeatureCache & features ) {
+		GenicamModelKey key;
+		key.vendor = readString( features, "DeviceVendorName" );
+		key.model = readString( features, "DeviceModelName" );
+		key.firmware = readString( features, "DeviceFirmwareVersion" );
+		if (key.firmware.empty()) key.firmware = readString( features, "DeviceVersion" );
+		return key;
+	}
+
+	void GenicamCache::setSettings( const GenicamCacheSettings & s ) {
+		settings = s;
+	}
+
+	const GenicamCacheSettings & GenicamCache::getSettings() const {
+		return settings;
+	}
+
+	std::string GenicamCache::directory() const {
+		return settings.directory.empty() ? ofToDataPath( "ofxAravis/genicam", true ) : settings.directory;
+	}
+
+	std::string GenicamCache::path( const GenicamModelKey & key, const std::string & extension ) const {
+		return ofFilePath::join( directory(), key.toString() + extension );
+	}
+
+	bool GenicamCache::loadOrBuild( ArvCamera * camera, FeatureCache & features, FeatureTree & tree ) {
+
+		ArvDevice * device = camera ? arv_camera_get_device( camera ) : nullptr;
+		ArvGc * genicam = device ? arv_device_get_genicam( device ) : nullptr;
+		if (!genicam) return false;
+
+		size_t size = 0;
+		const char * chars = arv_device_get_genicam_xml( device, &size );
+		std::string xml = chars ? std::string( chars, size ) : "";
+
+		GenicamModelKey key;
+		if (settings.enabled) {
+			key = GetGenicamModelKey( features );
+			if (key.isValid() && load( key, xml, genicam, tree )) return true;
+		}
+
+		if (!tree.build( genicam )) return false;
+		if (settings.enabled && key.isValid() && !xml.empty()) store( key, xml, tree );
+		return true;
+	}
+
+	bool GenicamCache::load( const GenicamModelKey & key, const std::string & xml, ArvGc * genicam, FeatureTree & tree ) {
+
+		std::string indexPath = path( key, ".json" );
+		if (!ofFile::doesFileExist( indexPath, false )) {
+			misses += 1;
+			return false;
+		}
+
+		ofJson index;
+		try {
+			std::ifstream file( indexPath );
+			file >> index;
+		} catch (std::exception & e) {
+			ofLogWarning("ofxAravis") << "GenicamCache: unreadable index " << indexPath << ": " << e.what();
+			misses += 1;
+			return false;
+		}
+
+		// same name and firmware with a different XML happens with custom builds, rebuild then
+		bool current = index.value( "version", 0 ) == INDEX_VERSION && index.value( "xmlHash", "" ) == hashOf( xml );
+
+		if (!current || !index.count( "entries" ) || !tree.fromJson( index["entries"], genicam )) {
+			misses += 1;
+			return false;
+		}
+
+		hits += 1;
+		return true;
+	}
+
+	bool GenicamCache::store( const GenicamModelKey & key, const std::string & xml, const FeatureTree & tree ) {
+
+		if (!ofDirectory::doesDirectoryExist( directory(), false ) && !ofDirectory::createDirectory( directory(), false, true )) {
+			ofLogWarning("ofxAravis") << "GenicamCache: can't create " << directory();
+			return false;
+		}
+
+		ofJson index;
+		index["version"] = INDEX_VERSION;
+		index["vendor"] = key.vendor;
+		index["model"] = key.model;
+		index["firmware"] = key.firmware;
+		index["xmlHash"] = hashOf( xml );
+		index["entries"] = tree.toJson();
+
+		// written under a temporary name and renamed, a crash never leaves half an index behind
+
+		std::string xmlPath = path( key, ".xml" );
+		std::string indexPath = path( key, ".json" );
+
+		std::lock_guard<std::mutex> lock( storeMutex );
+
+		{
+			std::ofstream file( xmlPath + ".tmp", std::ios::binary );
+			file.write( xml.data(), xml.size() );
+			if (!file) return false;
+		}
+		{
+			std::ofstream file( indexPath + ".tmp" );
+			file << index.dump();
+			if (!file) return false;
+		}
+
+		return std::rename( (xmlPath + ".tmp").c_str(), xmlPath.c_str() ) == 0
+			&& std::rename( (indexPath + ".tmp").c_str(), indexPath.c_str() ) == 0;
+	}
+
+	bool GenicamCache::has( const GenicamModelKey & key ) {
+		return ofFile::doesFileExist( path( key, ".json" ), false );
+	}
+
+	void GenicamCache::remove( const GenicamModelKey & key ) {
+		std::remove( path( key, ".json" ).c_str() );
+		std::remove( path( key, ".xml" ).c_str() );
+	}
+
+	std::string GenicamCache::getXML( const GenicamModelKey & key ) {
+		std::ifstream file( path( key, ".xml" ), std::ios::binary );
+		if (!file) return "";
+		std::stringstream text;
+		text << file.rdbuf();
+		return text.str();
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ofxAravis_features.h"
+#include "ofxAravis_tree.h"
+
+namespace ofxAravis {
+
+    // ------- GENICAM CACHE -------
+
+    // Keeps each camera model's GenICam XML and its prebuilt FeatureTree on disk, one pair of
+    // files per vendor / model / firmware. On a hit the tree is reattached to the freshly parsed
+    // document by node name instead of walking the category DOM again.
+    //
+    // Grabber and Camera only consult it on the first getFeatureTree() / listAllFeatures(), it
+    // costs the key reads and a hash there and nothing at open: arv_camera_new always fetches and
+    // parses the XML itself. The stored XML is there to validate the index and for offline tooling.
+
+    struct GenicamCacheSettings {
+        bool enabled = true;
+        std::string directory; // empty = ofToDataPath("ofxAravis/genicam")
+    };
+
+    struct GenicamModelKey {
+        std::string vendor;
+        std::string model;
+        std::string firmware;
+
+        bool isValid() const { return !vendor.empty() && !model.empty(); }
+        std::string toString() const; // file name safe
+    };
+
+    // DeviceVendorName, DeviceModelName and DeviceFirmwareVersion (DeviceVersion as a fallback)
+    GenicamModelKey GetGenicamModelKey( FeatureCache & features );
+
+    class GenicamCache {
+        public:
+            void setSettings( const GenicamCacheSettings & settings );
+            const GenicamCacheSettings & getSettings() const;
+
+            // fills tree from the cache, or builds it and stores it; false only when no tree could be made
+            bool loadOrBuild( ArvCamera * camera, FeatureCache & features, FeatureTree & tree );
+
+            bool load( const GenicamModelKey & key, const std::string & xml, ArvGc * genicam, FeatureTree & tree );
+            bool store( const GenicamModelKey & key, const std::string & xml, const FeatureTree & tree );
+            bool has( const GenicamModelKey & key );
+            void remove( const GenicamModelKey & key );
+
+            std::string getXML( const GenicamModelKey & key ); // cached copy, empty on a miss
+
+            uint64_t getHits() const { return hits; }
+            uint64_t getMisses() const { return misses; }
+
+        private:
+            std::string directory() const;
+            std::string path( const GenicamModelKey & key, const std::string & extension ) const;
+
+            GenicamCacheSettings settings;
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+    };
+
+}
@@ -0,0 +1,230 @@
+#include "ofxAravis_clock.h"
+
+#include <cmath>
+
+namespace ofxAravis {
+
+	namespace {
+
+		// a pair further off the fit than max( STEP_FLOOR, STEP_JITTERS * jitter ) is held back,
+		// STEP_SAMPLES of them in a row within that of each other are a host clock step
+
+		const double STEP_FLOOR = 5e6; // ns
+		const double STEP_JITTERS = 20;
+		const size_t STEP_SAMPLES = 8;
+
+		struct Fit {
+			double intercept = 0;
+			double slope = 0;
+			double jitter = 0;
+		};
+
+		Fit FitSums( const ClockSums & sums ) {
+			Fit fit;
+			if (sums.n < 2) return fit;
+			double xx = sums.xx - sums.x * sums.x / sums.n;
+			double xy = sums.xy - sums.x * sums.y / sums.n;
+			double yy = sums.yy - sums.y * sums.y / sums.n;
+			fit.slope = xx > 0 ? xy / xx : 0;
+			fit.intercept = (sums.y - fit.slope * sums.x) / sums.n;
+			fit.jitter = std::sqrt( std::max( yy - fit.slope * xy, 0.0 ) / sums.n );
+			return fit;
+		}
+
+		double residualOf( const ClockSums & sums, double intercept, double slope, const ClockPair & pair ) {
+			return sums.yOf( pair ) - (intercept + slope * sums.xOf( pair ));
+		}
+
+		template<typename Pairs>
+		ClockSums SumPairs( const Pairs & pairs ) {
+			ClockSums sums;
+			if (pairs.empty()) return sums;
+			sums.anchor = pairs.front();
+			for (auto & pair : pairs) sums.add( pair );
+			return sums;
+		}
+
+		template<typename Pairs>
+		double MaxResidual( const Pairs & pairs, const ClockSums & sums, const Fit & fit ) {
+			double max = 0;
+			for (auto & pair : pairs) max = std::max( max, std::abs( residualOf( sums, fit.intercept, fit.slope, pair ) ) );
+			return max;
+		}
+
+		ClockEstimate EstimateOf( const ClockSums & sums, const Fit & fit, const ClockPair & oldest, const ClockPair & newest, double maxResidual, size_t minSamples, double minSpan ) {
+			ClockEstimate estimate;
+			estimate.samples = size_t( sums.n + 0.5 );
+			if (estimate.samples < 2) return estimate;
+			double x = sums.xOf( newest );
+			estimate.span = double( gint64( newest.device - oldest.device ) ) / 1e9;
+			estimate.drift = fit.slope * 1e6;
+			estimate.offset = gint64( sums.anchor.host - sums.anchor.device ) + std::llround( fit.intercept + fit.slope * x );
+			estimate.jitter = fit.jitter;
+			estimate.maxResidual = maxResidual;
+			estimate.valid = estimate.samples >= minSamples && estimate.span >= minSpan;
+			return estimate;
+		}
+
+	}
+
+	// ------- CLOCK MODEL -------
+
+	double ClockSums::xOf( const ClockPair & pair ) const {
+		return double( gint64( pair.device - anchor.device ) );
+	}
+
+	double ClockSums::yOf( const ClockPair & pair ) const {
+		return double( gint64( pair.host - anchor.host ) - gint64( pair.device - anchor.device ) );
+	}
+
+	void ClockSums::add( const ClockPair & pair, double weight ) {
+		double px = xOf( pair );
+		double py = yOf( pair );
+		n += weight;
+		x += weight * px;
+		y += weight * py;
+		xx += weight * px * px;
+		xy += weight * px * py;
+		yy += weight * py * py;
+	}
+
+	ClockEstimate FitClock( const std::vector<ClockPair> & pairs, size_t minSamples, double minSpan ) {
+		if (pairs.empty()) return ClockEstimate();
+		ClockSums sums = SumPairs( pairs );
+		Fit fit = FitSums( sums );
+		return EstimateOf( sums, fit, pairs.front(), pairs.back(), MaxResidual( pairs, sums, fit ), minSamples, minSpan );
+	}
+
+	void ClockModel::setWindow( size_t samples, size_t min, double span ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		window = std::max<size_t>( samples, 2 );
+		minSamples = min;
+		minSpan = span;
+		while (this->samples.size() > window) this->samples.pop_front();
+		rebase();
+	}
+
+	void ClockModel::reset() {
+		std::lock_guard<std::mutex> lock( mutex );
+		samples.clear();
+		outliers.clear();
+		rebase();
+	}
+
+	void ClockModel::add( guint64 device, guint64 host ) {
+
+		std::lock_guard<std::mutex> lock( mutex );
+
+		// a camera that restarted counts from zero again
+		if (!samples.empty() && device <= samples.back().device) {
+			ofLogNotice("ofxAravis") << "ClockModel: device clock went back, starting over";
+			samples.clear();
+			outliers.clear();
+			rebase();
+		}
+
+		ClockPair pair;
+		pair.device = device;
+		pair.host = host;
+
+		// far off a valid fit: a late delivery, or the host clock stepped when enough agree
+
+		if (estimate.valid) {
+			double limit = std::max( STEP_FLOOR, STEP_JITTERS * estimate.jitter );
+			if (std::abs( residualOf( sums, intercept, slope, pair ) ) > limit) {
+				outliers.push_back( pair );
+				if (outliers.size() < STEP_SAMPLES) return;
+
+				double low = INFINITY, high = -INFINITY;
+				for (auto & outlier : outliers) {
+					double residual = residualOf( sums, intercept, slope, outlier );
+					low = std::min( low, residual );
+					high = std::max( high, residual );
+				}
+				if (high - low > limit) {
+					// spread out: a backlog draining, not a step
+					outliers.erase( outliers.begin() );
+					return;
+				}
+
+				ofLogNotice("ofxAravis") << "ClockModel: host clock stepped by " << (low + high) / 2e6 << " ms, starting over";
+				samples.assign( outliers.begin(), outliers.end() );
+				outliers.clear();
+				rebase();
+				return;
+			}
+			outliers.clear();
+		}
+
+		if (samples.empty()) sums.anchor = pair;
+
+		samples.push_back( pair );
+		sums.add( pair );
+		if (samples.size() > window) {
+			sums.add( samples.front(), -1 );
+			samples.pop_front();
+		}
+
+		// the anchor has left the window by now, sum again relative to the oldest pair
+		if (++sinceRebase >= window) {
+			rebase();
+			return;
+		}
+
+		Fit fit = FitSums( sums );
+		intercept = fit.intercept;
+		slope = fit.slope;
+		maxResidual = std::max( maxResidual, std::abs( residualOf( sums, intercept, slope, pair ) ) );
+		estimate = EstimateOf( sums, fit, samples.front(), samples.back(), maxResidual, minSamples, minSpan );
+	}
+
+	void ClockModel::add( const Frame & frame ) {
+		if (frame.timestamp == 0 || frame.systemTimestamp == 0) return;
+		add( frame.timestamp, frame.systemTimestamp );
+	}
+
+	void ClockModel::rebase() {
+		sums = SumPairs( samples );
+		Fit fit = FitSums( sums );
+		intercept = fit.intercept;
+		slope = fit.slope;
+		maxResidual = MaxResidual( samples, sums, fit );
+		estimate = samples.empty() ? ClockEstimate() : EstimateOf( sums, fit, samples.front(), samples.back(), maxResidual, minSamples, minSpan );
+		sinceRebase = 0;
+	}
+
+	bool ClockModel::isValid() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return estimate.valid;
+	}
+
+	guint64 ClockModel::toHost( guint64 device ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		if (!estimate.valid) return device;
+		gint64 x = gint64( device - sums.anchor.device );
+		return sums.anchor.host + guint64( x ) + guint64( std::llround( intercept + slope * double( x ) ) );
+	}
+
+	ClockEstimate ClockModel::getEstimate() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return estimate;
+	}
+
+	std::vector<ClockPair> ClockModel::getSamples() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return std::vector<ClockPair>( samples.begin(), samples.end() );
+	}
+
+	ofJson ClockEstimate::toJson() const {
+		ofJson json;
+		json["valid"] = valid;
+		json["samples"] = samples;
+		json["span"] = span;
+		json["driftPpm"] = drift;
+		json["offset"] = offset;
+		json["jitterUs"] = jitter / 1e3;
+		json["maxResidualUs"] = maxResidual / 1e3;
+		return json;
+	}
+
+}
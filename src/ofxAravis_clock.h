@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxAravis_frame.h"
+
+#include <deque>
+
+namespace ofxAravis {
+
+    // ------- CLOCK MODEL -------
+
+    // Maps a camera's own clock (Frame::timestamp) to the host clock of Frame::systemTimestamp,
+    // see HostTimestamp(), with a linear fit over the last N (device, host) pairs: host = device
+    // + offset + drift * device. Host times include the transport delay, so the mapped time is
+    // when a frame with that timestamp typically arrives, and jitter is how much single
+    // arrivals scatter around that; fused sensors see a constant delay, not noise.
+    //
+    // The fit is kept as running sums, one O(1) update per pair, and summed again from the
+    // window once per window length so rounding never builds up. It runs on differences from a
+    // recent pair, so ns since 1970 never meet squares in double precision. A device clock going
+    // backwards (camera reset) starts over, and so does the host clock stepping (NTP, a manual
+    // change): Frame::systemTimestamp is wall clock, as Aravis stamps it. Pairs far off the fit
+    // are held back, a run of them that agree with each other is taken as a step; fewer are late
+    // deliveries and never reach the fit.
+    // Offline, feed recorded pairs to add() or FitClock() and compare against live results.
+
+    struct ClockPair {
+        guint64 device = 0; // ns, camera clock
+        guint64 host = 0; // ns, host clock
+    };
+
+    struct ClockEstimate {
+        bool valid = false; // enough pairs over a long enough span
+        size_t samples = 0;
+        double span = 0; // s of device time covered by the window
+        double drift = 0; // ppm the camera clock runs slow (+) or fast (-) against the host
+        gint64 offset = 0; // ns, host minus device at the newest pair
+        double jitter = 0; // ns, rms of the residuals
+        double maxResidual = 0; // ns, exact over the window once per window length, the largest new residual in between
+
+        ofJson toJson() const;
+    };
+
+    // least squares sums of y = (host - device) relative to the anchor's against x = device since the anchor
+
+    struct ClockSums {
+        ClockPair anchor;
+        double n = 0, x = 0, y = 0, xx = 0, xy = 0, yy = 0;
+
+        double xOf( const ClockPair & pair ) const;
+        double yOf( const ClockPair & pair ) const;
+        void add( const ClockPair & pair, double weight = 1 ); // weight -1 takes a pair out again
+    };
+
+    // least squares over the pairs, nothing kept
+    ClockEstimate FitClock( const std::vector<ClockPair> & pairs, size_t minSamples = 16, double minSpan = 0.5 );
+
+    class ClockModel {
+        public:
+            void setWindow( size_t samples, size_t minSamples = 16, double minSpan = 0.5 ); // pairs kept, and what makes a fit valid
+            void reset();
+
+            void add( guint64 device, guint64 host ); // any thread
+            void add( const Frame & frame ); // skipped when the camera doesn't stamp frames
+
+            bool isValid();
+            guint64 toHost( guint64 device ); // device timestamp on the host clock, unchanged until valid
+            ClockEstimate getEstimate();
+            std::vector<ClockPair> getSamples(); // the current window, for recording
+
+        private:
+            void rebase(); // sums and fit from the window again
+
+            std::mutex mutex;
+            std::deque<ClockPair> samples;
+            std::vector<ClockPair> outliers; // consecutive pairs held back, see add()
+            size_t window = 512;
+            size_t minSamples = 16;
+            double minSpan = 0.5;
+
+            ClockSums sums;
+            size_t sinceRebase = 0;
+            double intercept = 0; // ns
+            double slope = 0; // drift as a ratio
+            double maxResidual = 0;
+            ClockEstimate estimate;
+    };
+
+}
@@ -0,0 +1,188 @@
+#include "ofxAravis_control.h"
+
+namespace ofxAravis {
+
+	// ------- CONTROL CHANNEL -------
+
+	ControlChannel::~ControlChannel() {
+		stop();
+	}
+
+	void ControlChannel::setFeatures( FeatureCache * f ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		features = f;
+	}
+
+	void ControlChannel::start() {
+		std::lock_guard<std::mutex> lock( mutex );
+		if (running) return;
+		running = true;
+		thread = std::thread( &ControlChannel::threadedFunction, this );
+	}
+
+	void ControlChannel::stop() {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (!running) return;
+			running = false;
+		}
+		wake.notify_all();
+		thread.join();
+
+		std::deque<Request> dropped;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			dropped.swap( queue );
+		}
+		ControlResult result;
+		result.message = "control channel stopped";
+		for (auto & request : dropped) complete( request, result );
+	}
+
+	std::future<ControlResult> ControlChannel::set( const std::string & key, const ofJson & value, ControlCallback callback ) {
+		return enqueue( SET, key, value, Call(), callback );
+	}
+
+	std::future<ControlResult> ControlChannel::get( const std::string & key, ControlCallback callback ) {
+		return enqueue( GET, key, nullptr, Call(), callback );
+	}
+
+	std::future<ControlResult> ControlChannel::execute( const std::string & command, ControlCallback callback ) {
+		return enqueue( EXECUTE, command, nullptr, Call(), callback );
+	}
+
+	std::future<ControlResult> ControlChannel::call( Call c, ControlCallback callback ) {
+		return enqueue( CALL, "", nullptr, c, callback );
+	}
+
+	std::future<ControlResult> ControlChannel::enqueue( Kind kind, const std::string & key, const ofJson & value, Call call, ControlCallback callback ) {
+
+		std::promise<ControlResult> promise;
+		std::future<ControlResult> future = promise.get_future();
+
+		std::unique_lock<std::mutex> lock( mutex );
+
+		if (!running) {
+			lock.unlock();
+			ControlResult result;
+			result.message = "control channel not running";
+			promise.set_value( result );
+			if (callback) callback( result );
+			return future;
+		}
+
+		// a slider sends a write per frame, only the newest one has to reach the camera. Merging
+		// only into the tail keeps writes to different features in the order they were sent
+
+		if (kind == SET && !queue.empty() && queue.back().kind == SET && queue.back().key == key) {
+			Request & last = queue.back();
+			last.value = value;
+			last.merged += 1;
+			last.promises.push_back( std::move( promise ) );
+			if (callback) last.callbacks.push_back( callback );
+			merged += 1;
+			return future;
+		}
+
+		Request request;
+		request.kind = kind;
+		request.key = key;
+		request.value = value;
+		request.call = call;
+		request.promises.push_back( std::move( promise ) );
+		if (callback) request.callbacks.push_back( callback );
+		queue.push_back( std::move( request ) );
+
+		lock.unlock();
+		wake.notify_one();
+		return future;
+	}
+
+	ControlResult ControlChannel::run( Request & request ) {
+
+		ControlResult result;
+		result.merged = request.merged;
+
+		if (!features) {
+			result.message = "no camera";
+			return result;
+		}
+
+		GError * err = nullptr;
+
+		switch (request.kind) {
+			case SET:
+				result.ok = features->setValue( request.key, request.value, &err );
+				result.value = request.value;
+				break;
+			case GET:
+				result.value = features->getValue( request.key, &err );
+				result.ok = !result.value.is_null();
+				break;
+			case EXECUTE:
+				result.ok = features->execute( request.key, &err );
+				break;
+			case CALL: {
+				std::lock_guard<std::recursive_mutex> control( features->getControlMutex() );
+				result.value = request.call( &err );
+				result.ok = true;
+				break;
+			}
+		}
+
+		if (err) {
+			result.ok = false;
+			result.message = err->message;
+			g_clear_error( &err );
+		} else if (!result.ok) {
+			result.message = "unknown feature or mismatched type: " + request.key;
+		}
+
+		return result;
+	}
+
+	void ControlChannel::complete( Request & request, const ControlResult & result ) {
+		for (auto & promise : request.promises) promise.set_value( result );
+		for (auto & callback : request.callbacks) callback( result );
+	}
+
+	size_t ControlChannel::getPending() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return queue.size();
+	}
+
+	uint64_t ControlChannel::getCompleted() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return completed;
+	}
+
+	uint64_t ControlChannel::getMerged() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return merged;
+	}
+
+	void ControlChannel::threadedFunction() {
+
+		std::unique_lock<std::mutex> lock( mutex );
+
+		while (running) {
+
+			if (queue.empty()) {
+				wake.wait( lock );
+				continue;
+			}
+
+			// taken off the queue before running, so new writes queue up behind it instead of merging into it
+			Request request = std::move( queue.front() );
+			queue.pop_front();
+
+			lock.unlock();
+			ControlResult result = run( request );
+			complete( request, result );
+			lock.lock();
+
+			completed += 1;
+		}
+	}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ofxAravis_features.h"
+
+#include <deque>
+#include <future>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+namespace ofxAravis {
+
+    // ------- CONTROL CHANNEL -------
+
+    // Feature traffic for one camera on its own worker thread, so a GigE round trip with resends
+    // never blocks the caller. Requests run in the order they were queued. A write to the same
+    // feature as the last queued request, when that one is a write too, is merged into it and only
+    // the newest value is sent; everyone waiting on either write gets the result of that one.
+    // Anything queued in between keeps both writes separate, so writes never change order.
+
+    struct ControlResult {
+        bool ok = false;
+        ofJson value; // read value, or the value that was written
+        std::string message; // device error, or why the request never ran
+        int merged = 0; // earlier writes this one replaced
+    };
+
+    using ControlCallback = std::function<void( const ControlResult & result )>; // on the worker thread
+
+    class ControlChannel {
+        public:
+            using Call = std::function<ofJson( GError ** err )>;
+
+            ~ControlChannel();
+
+            void setFeatures( FeatureCache * features ); // call before start
+            void start();
+            void stop(); // requests still queued complete with ok = false
+
+            std::future<ControlResult> set( const std::string & key, const ofJson & value, ControlCallback callback = ControlCallback() );
+            std::future<ControlResult> get( const std::string & key, ControlCallback callback = ControlCallback() );
+            std::future<ControlResult> execute( const std::string & command, ControlCallback callback = ControlCallback() );
+            std::future<ControlResult> call( Call call, ControlCallback callback = ControlCallback() ); // anything else, under the control lock
+
+            size_t getPending();
+            uint64_t getCompleted();
+            uint64_t getMerged();
+
+        private:
+            enum Kind { SET, GET, EXECUTE, CALL };
+
+            struct Request {
+                Kind kind;
+                std::string key;
+                ofJson value;
+                Call call;
+                int merged = 0;
+                std::vector<std::promise<ControlResult>> promises;
+                std::vector<ControlCallback> callbacks;
+            };
+
+            std::future<ControlResult> enqueue( Kind kind, const std::string & key, const ofJson & value, Call call, ControlCallback callback );
+            ControlResult run( Request & request );
+            void complete( Request & request, const ControlResult & result );
+            void threadedFunction();
+
+            FeatureCache * features = nullptr;
+            std::deque<Request> queue;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::thread thread;
+            bool running = false;
+            uint64_t completed = 0;
+            uint64_t merged = 0;
+    };
+
+}
@@ -0,0 +1,322 @@
+#include "ofxAravis_convert.h"
+#include "ofxAravis_simd.h"
+
+#include <vector>
+#include <cstring>
+
+namespace ofxAravis {
+
+	namespace {
+
+		// ------- FORMAT TABLE -------
+
+		// PFNC codes, spelled out because older Aravis headers lack the "p" formats
+
+		#define OFXARAVIS_FORMAT(code, name, layout, bits, packing, pattern) { ArvPixelFormat( code ), name, layout, bits, packing, pattern }
+
+		const PixelFormatInfo formats[] = {
+			OFXARAVIS_FORMAT( 0x01080001, "Mono8", PIXEL_MONO, 8, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x01100003, "Mono10", PIXEL_MONO, 10, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x01100005, "Mono12", PIXEL_MONO, 12, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x01100025, "Mono14", PIXEL_MONO, 14, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x01100007, "Mono16", PIXEL_MONO, 16, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x010A0046, "Mono10p", PIXEL_MONO, 10, PACKING_LSB, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x010C0047, "Mono12p", PIXEL_MONO, 12, PACKING_LSB, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x010C0004, "Mono10Packed", PIXEL_MONO, 10, PACKING_GVSP, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x010C0006, "Mono12Packed", PIXEL_MONO, 12, PACKING_GVSP, BAYER_RG ),
+
+			OFXARAVIS_FORMAT( 0x01080008, "BayerGR8", PIXEL_BAYER, 8, PACKING_NONE, BAYER_GR ),
+			OFXARAVIS_FORMAT( 0x01080009, "BayerRG8", PIXEL_BAYER, 8, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x0108000A, "BayerGB8", PIXEL_BAYER, 8, PACKING_NONE, BAYER_GB ),
+			OFXARAVIS_FORMAT( 0x0108000B, "BayerBG8", PIXEL_BAYER, 8, PACKING_NONE, BAYER_BG ),
+			OFXARAVIS_FORMAT( 0x0110000C, "BayerGR10", PIXEL_BAYER, 10, PACKING_NONE, BAYER_GR ),
+			OFXARAVIS_FORMAT( 0x0110000D, "BayerRG10", PIXEL_BAYER, 10, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x0110000E, "BayerGB10", PIXEL_BAYER, 10, PACKING_NONE, BAYER_GB ),
+			OFXARAVIS_FORMAT( 0x0110000F, "BayerBG10", PIXEL_BAYER, 10, PACKING_NONE, BAYER_BG ),
+			OFXARAVIS_FORMAT( 0x01100010, "BayerGR12", PIXEL_BAYER, 12, PACKING_NONE, BAYER_GR ),
+			OFXARAVIS_FORMAT( 0x01100011, "BayerRG12", PIXEL_BAYER, 12, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x01100012, "BayerGB12", PIXEL_BAYER, 12, PACKING_NONE, BAYER_GB ),
+			OFXARAVIS_FORMAT( 0x01100013, "BayerBG12", PIXEL_BAYER, 12, PACKING_NONE, BAYER_BG ),
+			OFXARAVIS_FORMAT( 0x0110002E, "BayerGR16", PIXEL_BAYER, 16, PACKING_NONE, BAYER_GR ),
+			OFXARAVIS_FORMAT( 0x0110002F, "BayerRG16", PIXEL_BAYER, 16, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x01100030, "BayerGB16", PIXEL_BAYER, 16, PACKING_NONE, BAYER_GB ),
+			OFXARAVIS_FORMAT( 0x01100031, "BayerBG16", PIXEL_BAYER, 16, PACKING_NONE, BAYER_BG ),
+			OFXARAVIS_FORMAT( 0x010A0056, "BayerGR10p", PIXEL_BAYER, 10, PACKING_LSB, BAYER_GR ),
+			OFXARAVIS_FORMAT( 0x010A0058, "BayerRG10p", PIXEL_BAYER, 10, PACKING_LSB, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x010A0054, "BayerGB10p", PIXEL_BAYER, 10, PACKING_LSB, BAYER_GB ),
+			OFXARAVIS_FORMAT( 0x010A0052, "BayerBG10p", PIXEL_BAYER, 10, PACKING_LSB, BAYER_BG ),
+			OFXARAVIS_FORMAT( 0x010C0057, "BayerGR12p", PIXEL_BAYER, 12, PACKING_LSB, BAYER_GR ),
+			OFXARAVIS_FORMAT( 0x010C0059, "BayerRG12p", PIXEL_BAYER, 12, PACKING_LSB, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x010C0055, "BayerGB12p", PIXEL_BAYER, 12, PACKING_LSB, BAYER_GB ),
+			OFXARAVIS_FORMAT( 0x010C0053, "BayerBG12p", PIXEL_BAYER, 12, PACKING_LSB, BAYER_BG ),
+			OFXARAVIS_FORMAT( 0x010C0026, "BayerGR10Packed", PIXEL_BAYER, 10, PACKING_GVSP, BAYER_GR ),
+			OFXARAVIS_FORMAT( 0x010C0027, "BayerRG10Packed", PIXEL_BAYER, 10, PACKING_GVSP, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x010C0028, "BayerGB10Packed", PIXEL_BAYER, 10, PACKING_GVSP, BAYER_GB ),
+			OFXARAVIS_FORMAT( 0x010C0029, "BayerBG10Packed", PIXEL_BAYER, 10, PACKING_GVSP, BAYER_BG ),
+			OFXARAVIS_FORMAT( 0x010C002A, "BayerGR12Packed", PIXEL_BAYER, 12, PACKING_GVSP, BAYER_GR ),
+			OFXARAVIS_FORMAT( 0x010C002B, "BayerRG12Packed", PIXEL_BAYER, 12, PACKING_GVSP, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x010C002C, "BayerGB12Packed", PIXEL_BAYER, 12, PACKING_GVSP, BAYER_GB ),
+			OFXARAVIS_FORMAT( 0x010C002D, "BayerBG12Packed", PIXEL_BAYER, 12, PACKING_GVSP, BAYER_BG ),
+
+			OFXARAVIS_FORMAT( 0x02180014, "RGB8", PIXEL_RGB, 8, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x02180015, "BGR8", PIXEL_BGR, 8, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x02200016, "RGBa8", PIXEL_RGBA, 8, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x02200017, "BGRa8", PIXEL_BGRA, 8, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x0210001F, "YUV422_8_UYVY", PIXEL_YUV422_UYVY, 8, PACKING_NONE, BAYER_RG ),
+			OFXARAVIS_FORMAT( 0x02100032, "YUV422_8", PIXEL_YUV422_YUYV, 8, PACKING_NONE, BAYER_RG )
+		};
+
+		#undef OFXARAVIS_FORMAT
+
+		// ------- SCALAR UNPACK -------
+
+		// sample i of an LSB first bit stream, 10 and 12-bit samples never span more than two bytes
+
+		inline uint16_t extract( const uint8_t * s, size_t i, int bits ) {
+			size_t bit = i * bits;
+			const uint8_t * b = s + (bit >> 3);
+			uint32_t v = b[0] | (uint32_t( b[1] ) << 8);
+			return uint16_t( (v >> (bit & 7)) & ((1u << bits) - 1) );
+		}
+
+		// GigE Vision packing, two samples in three bytes with the low bits of both in the middle byte
+
+		inline uint16_t extractGvsp( const uint8_t * s, size_t i, int bits ) {
+			const uint8_t * b = s + (i / 2) * 3;
+			if (bits == 12) return (i & 1) ? uint16_t( (b[2] << 4) | (b[1] >> 4) ) : uint16_t( (b[0] << 4) | (b[1] & 0xF) );
+			return (i & 1) ? uint16_t( (b[2] << 2) | ((b[1] >> 4) & 3) ) : uint16_t( (b[0] << 2) | (b[1] & 3) );
+		}
+
+		size_t packedSize( int bits, PixelPacking packing, size_t count ) {
+			if (packing == PACKING_GVSP) return (count / 2) * 3 + (count & 1) * 2;
+			return (count * bits + 7) / 8;
+		}
+
+#ifdef OFXARAVIS_X86
+
+		// ------- SSE4.1 UNPACK -------
+
+		// 8 samples per iteration from 10 or 12 bytes (always 12 for GigE Vision packing). pshufb gathers the two bytes holding each sample
+		// into its 16-bit lane, then shifts and masks finish the job. Every load reads 16 bytes,
+		// the scalar loop picks up the last few samples.
+
+		OFXARAVIS_TARGET_SSE41 inline __m128i load( const uint8_t * s, size_t i, int group, __m128i shuffle ) {
+			return _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *)( s + (i / 8) * group ) ), shuffle );
+		}
+
+		OFXARAVIS_TARGET_SSE41 inline void store( uint16_t * d, size_t i, __m128i v ) {
+			_mm_storeu_si128( (__m128i *)( d + i ), v );
+		}
+
+		OFXARAVIS_TARGET_SSE41 size_t unpackSSE41( const uint8_t * s, size_t srcSize, int bits, PixelPacking packing, size_t count, uint16_t * d ) {
+
+			size_t i = 0;
+			int group = packing == PACKING_GVSP ? 12 : bits; // bytes per 8 samples
+			auto fits = [&] ( size_t i ) { return i + 8 <= count && (i / 8) * group + 16 <= srcSize; };
+
+			if (packing == PACKING_LSB && bits == 12) {
+				const __m128i shuffle = _mm_setr_epi8( 0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11 );
+				const __m128i mask = _mm_set1_epi16( 0x0FFF );
+				for (; fits( i ); i += 8) {
+					__m128i v = load( s, i, group, shuffle );
+					store( d, i, _mm_blend_epi16( _mm_and_si128( v, mask ), _mm_srli_epi16( v, 4 ), 0xAA ) );
+				}
+			}
+			else if (packing == PACKING_LSB && bits == 10) {
+				// per lane right shifts of 0, 2, 4, 6 as a multiply high, lanes 0 and 4 need no shift
+				const __m128i shuffle = _mm_setr_epi8( 0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9 );
+				const __m128i shift = _mm_setr_epi16( 0, 1 << 14, 1 << 12, 1 << 10, 0, 1 << 14, 1 << 12, 1 << 10 );
+				const __m128i mask = _mm_set1_epi16( 0x03FF );
+				for (; fits( i ); i += 8) {
+					__m128i v = load( s, i, group, shuffle );
+					store( d, i, _mm_and_si128( _mm_blend_epi16( _mm_mulhi_epu16( v, shift ), v, 0x11 ), mask ) );
+				}
+			}
+			else if (packing == PACKING_GVSP) {
+				// even lanes hold (middle byte, first byte), odd lanes (middle byte, last byte)
+				const __m128i shuffle = _mm_setr_epi8( 1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11 );
+				int low = bits - 8;
+				const __m128i lowMask = _mm_set1_epi16( (1 << low) - 1 );
+				const __m128i highMask = _mm_set1_epi16( 0xFF << low );
+				const __m128i count8 = _mm_cvtsi32_si128( 8 - low );
+				for (; fits( i ); i += 8) {
+					__m128i v = load( s, i, group, shuffle );
+					__m128i high = _mm_and_si128( _mm_srl_epi16( v, count8 ), highMask );
+					__m128i even = _mm_and_si128( v, lowMask );
+					__m128i odd = _mm_and_si128( _mm_srli_epi16( v, 4 ), lowMask );
+					store( d, i, _mm_or_si128( high, _mm_blend_epi16( even, odd, 0xAA ) ) );
+				}
+			}
+
+			return i;
+		}
+
+#endif
+
+		// ------- RGB8 -------
+
+		template<typename T>
+		void monoRow( const T * s, int width, int shift, uint8_t * d ) {
+			for (int x = 0; x < width; x++) {
+				uint8_t v = uint8_t( s[x] >> shift );
+				d[0] = d[1] = d[2] = v;
+				d += 3;
+			}
+		}
+
+		void swizzleRow( const uint8_t * s, int width, int channels, bool swap, uint8_t * d ) {
+			if (channels == 3 && !swap) {
+				memcpy( d, s, size_t( width ) * 3 );
+				return;
+			}
+			int r = swap ? 2 : 0;
+			int b = swap ? 0 : 2;
+			for (int x = 0; x < width; x++) {
+				d[0] = s[r];
+				d[1] = s[1];
+				d[2] = s[b];
+				s += channels;
+				d += 3;
+			}
+		}
+
+		inline uint8_t clamp8( int v ) {
+			return uint8_t( v < 0 ? 0 : (v > 255 ? 255 : v) );
+		}
+
+		// BT.601 video range, the usual integer form
+
+		void yuvRow( const uint8_t * s, int width, bool uyvy, uint8_t * d ) {
+			int y0 = uyvy ? 1 : 0;
+			int u = uyvy ? 0 : 1;
+			for (int x = 0; x + 1 < width; x += 2) {
+				int cu = s[u] - 128;
+				int cv = s[u + 2] - 128;
+				int r = 409 * cv + 128;
+				int g = -100 * cu - 208 * cv + 128;
+				int b = 516 * cu + 128;
+				for (int k = 0; k < 2; k++) {
+					int c = 298 * (s[y0 + k * 2] - 16);
+					d[0] = clamp8( (c + r) >> 8 );
+					d[1] = clamp8( (c + g) >> 8 );
+					d[2] = clamp8( (c + b) >> 8 );
+					d += 3;
+				}
+				s += 4;
+			}
+		}
+
+		// 16-bit samples of a packed frame, reused per thread so conversion workers never allocate
+
+		const uint16_t * unpackFrame( const Frame & raw, const PixelFormatInfo & info ) {
+			thread_local std::vector<uint16_t> scratch;
+			size_t count = size_t( raw.width ) * raw.height;
+			if (scratch.size() < count) scratch.resize( count );
+			if (!UnpackBits( raw.data, raw.size, info.bitDepth, info.packing, count, scratch.data() )) return nullptr;
+			return scratch.data();
+		}
+
+		int bytesPerSample( const PixelFormatInfo & info ) {
+			return info.bitDepth > 8 ? 2 : 1;
+		}
+
+	}
+
+	const PixelFormatInfo * GetPixelFormatInfo( ArvPixelFormat format ) {
+		for (auto & info : formats) {
+			if (info.format == format) return &info;
+		}
+		return nullptr;
+	}
+
+	bool UnpackBits( const uint8_t * src, size_t srcSize, int bitDepth, PixelPacking packing, size_t count, uint16_t * dst ) {
+
+		if (packing == PACKING_NONE || (bitDepth != 10 && bitDepth != 12)) return false;
+		if (srcSize < packedSize( bitDepth, packing, count )) return false;
+
+		size_t i = 0;
+#ifdef OFXARAVIS_X86
+		if (GetDemosaicKernel() >= DEMOSAIC_SSE41) i = unpackSSE41( src, srcSize, bitDepth, packing, count, dst );
+#endif
+		if (packing == PACKING_GVSP) {
+			for (; i < count; i++) dst[i] = extractGvsp( src, i, bitDepth );
+		}
+		else {
+			for (; i < count; i++) dst[i] = extract( src, i, bitDepth );
+		}
+		return true;
+	}
+
+	bool Unpack16( const Frame & raw, uint16_t * dst ) {
+
+		const PixelFormatInfo * info = GetPixelFormatInfo( raw.pixelFormat );
+		if (!info || (info->layout != PIXEL_MONO && info->layout != PIXEL_BAYER)) return false;
+
+		size_t count = size_t( raw.width ) * raw.height;
+		if (info->packing != PACKING_NONE) return UnpackBits( raw.data, raw.size, info->bitDepth, info->packing, count, dst );
+
+		int rowBytes = raw.width * bytesPerSample( *info );
+		if (raw.step < rowBytes || size_t( raw.step ) * raw.height > raw.size) return false;
+
+		for (int y = 0; y < raw.height; y++) {
+			const uint8_t * s = raw.data + size_t( y ) * raw.step;
+			uint16_t * d = dst + size_t( y ) * raw.width;
+			if (info->bitDepth == 8) {
+				for (int x = 0; x < raw.width; x++) d[x] = s[x];
+			}
+			else {
+				memcpy( d, s, size_t( rowBytes ) );
+			}
+		}
+		return true;
+	}
+
+	bool ConvertToRGB8( const Frame & raw, uint8_t * dst, int dstStep ) {
+
+		const PixelFormatInfo * info = GetPixelFormatInfo( raw.pixelFormat );
+		if (!info || raw.width < 2 || raw.height < 2) return false;
+
+		const uint8_t * src = raw.data;
+		int srcStep = raw.step;
+
+		if (info->packing != PACKING_NONE) {
+			const uint16_t * unpacked = unpackFrame( raw, *info );
+			if (!unpacked) return false;
+			src = reinterpret_cast<const uint8_t *>( unpacked );
+			srcStep = raw.width * 2;
+		}
+		else {
+			int channels = info->layout == PIXEL_RGBA || info->layout == PIXEL_BGRA ? 4 : (info->layout == PIXEL_RGB || info->layout == PIXEL_BGR ? 3 : 1);
+			if (info->layout == PIXEL_YUV422_UYVY || info->layout == PIXEL_YUV422_YUYV) channels = 2;
+			int rowBytes = raw.width * channels * bytesPerSample( *info );
+			if (srcStep < rowBytes || size_t( srcStep ) * raw.height > raw.size) return false;
+		}
+
+		if (info->layout == PIXEL_BAYER) {
+			DemosaicRGB8( src, srcStep, raw.width, raw.height, info->bitDepth, info->pattern, dst, dstStep );
+			return true;
+		}
+
+		for (int y = 0; y < raw.height; y++) {
+
+			const uint8_t * s = src + size_t( y ) * srcStep;
+			uint8_t * d = dst + size_t( y ) * dstStep;
+
+			switch (info->layout) {
+				case PIXEL_MONO:
+					if (info->bitDepth == 8) monoRow( s, raw.width, 0, d );
+					else monoRow( reinterpret_cast<const uint16_t *>( s ), raw.width, info->bitDepth - 8, d );
+					break;
+				case PIXEL_RGB: swizzleRow( s, raw.width, 3, false, d ); break;
+				case PIXEL_BGR: swizzleRow( s, raw.width, 3, true, d ); break;
+				case PIXEL_RGBA: swizzleRow( s, raw.width, 4, false, d ); break;
+				case PIXEL_BGRA: swizzleRow( s, raw.width, 4, true, d ); break;
+				case PIXEL_YUV422_UYVY: yuvRow( s, raw.width, true, d ); break;
+				case PIXEL_YUV422_YUYV: yuvRow( s, raw.width, false, d ); break;
+				default: return false;
+			}
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <arv.h>
+
+#include "ofxAravis_frame.h"
+#include "ofxAravis_demosaic.h"
+
+namespace ofxAravis {
+
+    // ------- PIXEL FORMATS -------
+
+    enum PixelLayout {
+        PIXEL_MONO,
+        PIXEL_BAYER,
+        PIXEL_RGB,
+        PIXEL_BGR,
+        PIXEL_RGBA,
+        PIXEL_BGRA,
+        PIXEL_YUV422_UYVY,
+        PIXEL_YUV422_YUYV
+    };
+
+    enum PixelPacking {
+        PACKING_NONE, // one sample per byte, or LSB aligned in 16-bit containers
+        PACKING_LSB, // PFNC "p" formats (Mono12p, BayerRG10p), continuous little endian bit stream
+        PACKING_GVSP // GigE Vision "Packed" formats (Mono12Packed), 2 samples in 3 bytes
+    };
+
+    struct PixelFormatInfo {
+        ArvPixelFormat format;
+        const char * name;
+        PixelLayout layout;
+        int bitDepth; // bits per sample
+        PixelPacking packing;
+        BayerPattern pattern; // PIXEL_BAYER only
+    };
+
+    // nullptr when the format is not supported
+    const PixelFormatInfo * GetPixelFormatInfo( ArvPixelFormat format );
+
+    // ------- CONVERSION -------
+
+    // Any supported format to interleaved RGB8, dst must hold height rows of dstStep bytes.
+    bool ConvertToRGB8( const Frame & raw, uint8_t * dst, int dstStep );
+
+    // Mono and Bayer formats to LSB aligned 16-bit samples, width * height of them.
+    // This is how packed formats reach code that expects plain 16-bit pixels.
+    bool Unpack16( const Frame & raw, uint16_t * dst );
+
+    // Unpacks count samples from a packed bit stream, returns false when src is too small.
+    bool UnpackBits( const uint8_t * src, size_t srcSize, int bitDepth, PixelPacking packing, size_t count, uint16_t * dst );
+
+}
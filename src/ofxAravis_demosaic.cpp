@@ -0,0 +1,395 @@
+#include "ofxAravis_demosaic.h"
+#include "ofxAravis_simd.h"
+
+namespace ofxAravis {
+
+	namespace {
+
+		// ------- CFA -------
+
+		// per row parity: does the row carry red (otherwise blue), and which column parity is green
+
+		struct Cfa {
+			bool rowHasR[2];
+			int gParity[2];
+		};
+
+		Cfa getCfa( BayerPattern pattern ) {
+			switch (pattern) {
+				case BAYER_RG: return { { true, false }, { 1, 0 } };
+				case BAYER_GB: return { { false, true }, { 0, 1 } };
+				case BAYER_GR: return { { true, false }, { 0, 1 } };
+				default: return { { false, true }, { 1, 0 } }; // BAYER_BG
+			}
+		}
+
+		struct Params {
+			const uint8_t * src;
+			int srcStep;
+			int width;
+			int height;
+			Cfa cfa;
+			uint8_t * dst;
+			int dstStep;
+			bool rgb16;
+			int shift; // right shift to RGB8, left shift to RGB16
+		};
+
+		template<typename T>
+		inline const T * row( const Params & p, int y ) {
+			return reinterpret_cast<const T *>( p.src + size_t(y) * p.srcStep );
+		}
+
+		inline int reflect( int i, int n ) {
+			return i < 0 ? -i : (i >= n ? 2 * n - 2 - i : i);
+		}
+
+		// ------- SCALAR -------
+
+		// red row:  red site = (c, x4, d4), green site = (h2, c, v2)
+		// blue row: red and blue swap
+
+		inline void bilinear( uint32_t c, uint32_t n, uint32_t s, uint32_t w, uint32_t e, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se, bool rowHasR, bool isG, uint32_t rgb[3] ) {
+
+			uint32_t h2 = (w + e + 1) >> 1;
+			uint32_t v2 = (n + s + 1) >> 1;
+			uint32_t x4 = (n + s + w + e + 2) >> 2;
+			uint32_t d4 = (nw + ne + sw + se + 2) >> 2;
+
+			uint32_t a = isG ? h2 : c;
+			uint32_t z = isG ? v2 : d4;
+
+			rgb[0] = rowHasR ? a : z;
+			rgb[1] = isG ? c : x4;
+			rgb[2] = rowHasR ? z : a;
+		}
+
+		inline void store( const Params & p, int x, int y, const uint32_t rgb[3] ) {
+			uint8_t * d = p.dst + size_t(y) * p.dstStep;
+			if (p.rgb16) {
+				uint16_t * d16 = reinterpret_cast<uint16_t *>( d ) + size_t(x) * 3;
+				d16[0] = uint16_t( rgb[0] << p.shift );
+				d16[1] = uint16_t( rgb[1] << p.shift );
+				d16[2] = uint16_t( rgb[2] << p.shift );
+			} else {
+				uint8_t * d8 = d + size_t(x) * 3;
+				d8[0] = uint8_t( rgb[0] >> p.shift );
+				d8[1] = uint8_t( rgb[1] >> p.shift );
+				d8[2] = uint8_t( rgb[2] >> p.shift );
+			}
+		}
+
+		template<typename T>
+		inline void pixel( const Params & p, int x, int y, bool mirror ) {
+
+			int xw = x - 1, xe = x + 1, yn = y - 1, ys = y + 1;
+			if (mirror) {
+				xw = reflect( xw, p.width );
+				xe = reflect( xe, p.width );
+				yn = reflect( yn, p.height );
+				ys = reflect( ys, p.height );
+			}
+
+			const T * rn = row<T>( p, yn );
+			const T * rc = row<T>( p, y );
+			const T * rs = row<T>( p, ys );
+
+			uint32_t rgb[3];
+			bilinear( rc[x], rn[x], rs[x], rc[xw], rc[xe], rn[xw], rn[xe], rs[xw], rs[xe], p.cfa.rowHasR[y & 1], (x & 1) == p.cfa.gParity[y & 1], rgb );
+			store( p, x, y, rgb );
+		}
+
+#ifdef OFXARAVIS_X86
+
+		// ------- SSE4.1 -------
+
+		// pshufb masks that interleave three planes into packed RGB, [output register][channel]
+
+		struct Interleave {
+			alignas(16) uint8_t rgb8[3][3][16];
+			alignas(16) uint8_t rgb16[3][3][16];
+
+			Interleave() {
+				for (int k = 0; k < 3; k++) {
+					for (int c = 0; c < 3; c++) {
+						for (int i = 0; i < 16; i++) {
+							int j = k * 16 + i;
+							rgb8[k][c][i] = (j % 3 == c) ? uint8_t( j / 3 ) : 0x80;
+							rgb16[k][c][i] = ((j / 2) % 3 == c) ? uint8_t( (j / 6) * 2 + (j % 2) ) : 0x80;
+						}
+					}
+				}
+			}
+		};
+
+		const Interleave & interleave() {
+			static Interleave masks;
+			return masks;
+		}
+
+		// exact (a + b + c + d + 2) >> 2 without leaving 16-bit lanes
+
+		OFXARAVIS_TARGET_SSE41 inline __m128i quad( __m128i a, __m128i b, __m128i c, __m128i d ) {
+			const __m128i three = _mm_set1_epi16( 3 );
+			__m128i hi = _mm_add_epi16( _mm_add_epi16( _mm_srli_epi16( a, 2 ), _mm_srli_epi16( b, 2 ) ), _mm_add_epi16( _mm_srli_epi16( c, 2 ), _mm_srli_epi16( d, 2 ) ) );
+			__m128i lo = _mm_add_epi16( _mm_add_epi16( _mm_and_si128( a, three ), _mm_and_si128( b, three ) ), _mm_add_epi16( _mm_and_si128( c, three ), _mm_and_si128( d, three ) ) );
+			return _mm_add_epi16( hi, _mm_srli_epi16( _mm_add_epi16( lo, _mm_set1_epi16( 2 ) ), 2 ) );
+		}
+
+		OFXARAVIS_TARGET_SSE41 inline void load16( const uint8_t * r, __m128i & lo, __m128i & hi ) {
+			__m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( r ) );
+			lo = _mm_cvtepu8_epi16( v );
+			hi = _mm_cvtepu8_epi16( _mm_srli_si128( v, 8 ) );
+		}
+
+		OFXARAVIS_TARGET_SSE41 inline void load16( const uint16_t * r, __m128i & lo, __m128i & hi ) {
+			lo = _mm_loadu_si128( reinterpret_cast<const __m128i *>( r ) );
+			hi = _mm_loadu_si128( reinterpret_cast<const __m128i *>( r + 8 ) );
+		}
+
+		OFXARAVIS_TARGET_SSE41 inline void bilinear( __m128i c, __m128i n, __m128i s, __m128i w, __m128i e, __m128i nw, __m128i ne, __m128i sw, __m128i se, __m128i gmask, bool rowHasR, __m128i & r, __m128i & g, __m128i & b ) {
+
+			__m128i h2 = _mm_avg_epu16( w, e );
+			__m128i v2 = _mm_avg_epu16( n, s );
+			__m128i x4 = quad( n, s, w, e );
+			__m128i d4 = quad( nw, ne, sw, se );
+
+			__m128i a = _mm_blendv_epi8( c, h2, gmask );
+			__m128i z = _mm_blendv_epi8( d4, v2, gmask );
+
+			r = rowHasR ? a : z;
+			g = _mm_blendv_epi8( x4, c, gmask );
+			b = rowHasR ? z : a;
+		}
+
+		OFXARAVIS_TARGET_SSE41 inline void storeRGB8( uint8_t * d, __m128i rlo, __m128i rhi, __m128i glo, __m128i ghi, __m128i blo, __m128i bhi, __m128i shift ) {
+
+			__m128i r = _mm_packus_epi16( _mm_srl_epi16( rlo, shift ), _mm_srl_epi16( rhi, shift ) );
+			__m128i g = _mm_packus_epi16( _mm_srl_epi16( glo, shift ), _mm_srl_epi16( ghi, shift ) );
+			__m128i b = _mm_packus_epi16( _mm_srl_epi16( blo, shift ), _mm_srl_epi16( bhi, shift ) );
+
+			const Interleave & m = interleave();
+			for (int k = 0; k < 3; k++) {
+				__m128i out = _mm_or_si128(
+					_mm_or_si128( _mm_shuffle_epi8( r, _mm_load_si128( reinterpret_cast<const __m128i *>( m.rgb8[k][0] ) ) ),
+								  _mm_shuffle_epi8( g, _mm_load_si128( reinterpret_cast<const __m128i *>( m.rgb8[k][1] ) ) ) ),
+					_mm_shuffle_epi8( b, _mm_load_si128( reinterpret_cast<const __m128i *>( m.rgb8[k][2] ) ) ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i *>( d + k * 16 ), out );
+			}
+		}
+
+		OFXARAVIS_TARGET_SSE41 inline void storeRGB16( uint16_t * d, __m128i r, __m128i g, __m128i b, __m128i shift ) {
+
+			r = _mm_sll_epi16( r, shift );
+			g = _mm_sll_epi16( g, shift );
+			b = _mm_sll_epi16( b, shift );
+
+			const Interleave & m = interleave();
+			for (int k = 0; k < 3; k++) {
+				__m128i out = _mm_or_si128(
+					_mm_or_si128( _mm_shuffle_epi8( r, _mm_load_si128( reinterpret_cast<const __m128i *>( m.rgb16[k][0] ) ) ),
+								  _mm_shuffle_epi8( g, _mm_load_si128( reinterpret_cast<const __m128i *>( m.rgb16[k][1] ) ) ) ),
+					_mm_shuffle_epi8( b, _mm_load_si128( reinterpret_cast<const __m128i *>( m.rgb16[k][2] ) ) ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i *>( d ) + k, out );
+			}
+		}
+
+		OFXARAVIS_TARGET_SSE41 inline void storeRow( const Params & p, int x, int y, __m128i rlo, __m128i rhi, __m128i glo, __m128i ghi, __m128i blo, __m128i bhi, __m128i shift ) {
+			uint8_t * d = p.dst + size_t(y) * p.dstStep;
+			if (p.rgb16) {
+				uint16_t * d16 = reinterpret_cast<uint16_t *>( d ) + size_t(x) * 3;
+				storeRGB16( d16, rlo, glo, blo, shift );
+				storeRGB16( d16 + 24, rhi, ghi, bhi, shift );
+			} else {
+				storeRGB8( d + size_t(x) * 3, rlo, rhi, glo, ghi, blo, bhi, shift );
+			}
+		}
+
+		// interior of row y from x = 1, 16 pixels per step, returns where the scalar loop picks up
+
+		template<typename T>
+		OFXARAVIS_TARGET_SSE41 int rowSSE41( const Params & p, int y ) {
+
+			const T * rn = row<T>( p, y - 1 );
+			const T * rc = row<T>( p, y );
+			const T * rs = row<T>( p, y + 1 );
+
+			bool rowHasR = p.cfa.rowHasR[y & 1];
+			bool greenEven = (1 == p.cfa.gParity[y & 1]); // lane 0 is x = 1
+			__m128i gmask = greenEven ? _mm_set1_epi32( 0x0000FFFF ) : _mm_set1_epi32( int( 0xFFFF0000 ) );
+			__m128i shift = _mm_cvtsi32_si128( p.shift );
+
+			int x = 1;
+			for (; x + 16 <= p.width - 1; x += 16) {
+
+				__m128i nwl, nwh, nl, nh, nel, neh, wl, wh, cl, ch, el, eh, swl, swh, sl, sh, sel, seh;
+				load16( rn + x - 1, nwl, nwh ); load16( rn + x, nl, nh ); load16( rn + x + 1, nel, neh );
+				load16( rc + x - 1, wl, wh );   load16( rc + x, cl, ch ); load16( rc + x + 1, el, eh );
+				load16( rs + x - 1, swl, swh ); load16( rs + x, sl, sh ); load16( rs + x + 1, sel, seh );
+
+				__m128i rlo, glo, blo, rhi, ghi, bhi;
+				bilinear( cl, nl, sl, wl, el, nwl, nel, swl, sel, gmask, rowHasR, rlo, glo, blo );
+				bilinear( ch, nh, sh, wh, eh, nwh, neh, swh, seh, gmask, rowHasR, rhi, ghi, bhi );
+
+				storeRow( p, x, y, rlo, rhi, glo, ghi, blo, bhi, shift );
+			}
+			return x;
+		}
+
+		// ------- AVX2 -------
+
+		OFXARAVIS_TARGET_AVX2 inline __m256i quad( __m256i a, __m256i b, __m256i c, __m256i d ) {
+			const __m256i three = _mm256_set1_epi16( 3 );
+			__m256i hi = _mm256_add_epi16( _mm256_add_epi16( _mm256_srli_epi16( a, 2 ), _mm256_srli_epi16( b, 2 ) ), _mm256_add_epi16( _mm256_srli_epi16( c, 2 ), _mm256_srli_epi16( d, 2 ) ) );
+			__m256i lo = _mm256_add_epi16( _mm256_add_epi16( _mm256_and_si256( a, three ), _mm256_and_si256( b, three ) ), _mm256_add_epi16( _mm256_and_si256( c, three ), _mm256_and_si256( d, three ) ) );
+			return _mm256_add_epi16( hi, _mm256_srli_epi16( _mm256_add_epi16( lo, _mm256_set1_epi16( 2 ) ), 2 ) );
+		}
+
+		OFXARAVIS_TARGET_AVX2 inline __m256i load16( const uint8_t * r ) {
+			return _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i *>( r ) ) );
+		}
+
+		OFXARAVIS_TARGET_AVX2 inline __m256i load16( const uint16_t * r ) {
+			return _mm256_loadu_si256( reinterpret_cast<const __m256i *>( r ) );
+		}
+
+		template<typename T>
+		OFXARAVIS_TARGET_AVX2 int rowAVX2( const Params & p, int y ) {
+
+			const T * rn = row<T>( p, y - 1 );
+			const T * rc = row<T>( p, y );
+			const T * rs = row<T>( p, y + 1 );
+
+			bool rowHasR = p.cfa.rowHasR[y & 1];
+			bool greenEven = (1 == p.cfa.gParity[y & 1]);
+			__m256i gmask = greenEven ? _mm256_set1_epi32( 0x0000FFFF ) : _mm256_set1_epi32( int( 0xFFFF0000 ) );
+			__m128i shift = _mm_cvtsi32_si128( p.shift );
+
+			int x = 1;
+			for (; x + 16 <= p.width - 1; x += 16) {
+
+				__m256i nw = load16( rn + x - 1 ), n = load16( rn + x ), ne = load16( rn + x + 1 );
+				__m256i w = load16( rc + x - 1 ),  c = load16( rc + x ),  e = load16( rc + x + 1 );
+				__m256i sw = load16( rs + x - 1 ), s = load16( rs + x ), se = load16( rs + x + 1 );
+
+				__m256i h2 = _mm256_avg_epu16( w, e );
+				__m256i v2 = _mm256_avg_epu16( n, s );
+				__m256i x4 = quad( n, s, w, e );
+				__m256i d4 = quad( nw, ne, sw, se );
+
+				__m256i a = _mm256_blendv_epi8( c, h2, gmask );
+				__m256i z = _mm256_blendv_epi8( d4, v2, gmask );
+				__m256i r = rowHasR ? a : z;
+				__m256i g = _mm256_blendv_epi8( x4, c, gmask );
+				__m256i b = rowHasR ? z : a;
+
+				storeRow( p, x, y,
+					_mm256_castsi256_si128( r ), _mm256_extracti128_si256( r, 1 ),
+					_mm256_castsi256_si128( g ), _mm256_extracti128_si256( g, 1 ),
+					_mm256_castsi256_si128( b ), _mm256_extracti128_si256( b, 1 ), shift );
+			}
+			return x;
+		}
+
+#endif
+
+		// ------- DRIVER -------
+
+		DemosaicKernel resolve( DemosaicKernel kernel ) {
+			DemosaicKernel best = GetDemosaicKernel();
+			if (kernel == DEMOSAIC_AUTO || kernel > best) return best;
+			return kernel;
+		}
+
+		template<typename T>
+		void run( const Params & p, DemosaicKernel kernel ) {
+
+			for (int y = 0; y < p.height; y++) {
+
+				if (y == 0 || y == p.height - 1) {
+					for (int x = 0; x < p.width; x++) pixel<T>( p, x, y, true );
+					continue;
+				}
+
+				pixel<T>( p, 0, y, true );
+
+				int x = 1;
+#ifdef OFXARAVIS_X86
+				if (kernel == DEMOSAIC_AVX2) x = rowAVX2<T>( p, y );
+				else if (kernel == DEMOSAIC_SSE41) x = rowSSE41<T>( p, y );
+#endif
+				for (; x < p.width - 1; x++) pixel<T>( p, x, y, false );
+
+				pixel<T>( p, p.width - 1, y, true );
+			}
+		}
+
+		void demosaic( const void * src, int srcStep, int width, int height, int bitDepth, BayerPattern pattern, void * dst, int dstStep, bool rgb16, DemosaicKernel kernel, bool reference ) {
+
+			if (width < 2 || height < 2) return;
+			if (bitDepth < 8) bitDepth = 8;
+			if (bitDepth > 16) bitDepth = 16;
+
+			Params p;
+			p.src = static_cast<const uint8_t *>( src );
+			p.srcStep = srcStep;
+			p.width = width;
+			p.height = height;
+			p.cfa = getCfa( pattern );
+			p.dst = static_cast<uint8_t *>( dst );
+			p.dstStep = dstStep;
+			p.rgb16 = rgb16;
+			p.shift = rgb16 ? 16 - bitDepth : bitDepth - 8;
+
+			if (reference) {
+				for (int y = 0; y < height; y++) {
+					for (int x = 0; x < width; x++) {
+						if (bitDepth == 8) pixel<uint8_t>( p, x, y, true );
+						else pixel<uint16_t>( p, x, y, true );
+					}
+				}
+				return;
+			}
+
+			if (bitDepth == 8) run<uint8_t>( p, resolve( kernel ) );
+			else run<uint16_t>( p, resolve( kernel ) );
+		}
+
+	}
+
+	void DemosaicRGB8( const void * src, int srcStep, int width, int height, int bitDepth, BayerPattern pattern, uint8_t * dst, int dstStep, DemosaicKernel kernel ) {
+		demosaic( src, srcStep, width, height, bitDepth, pattern, dst, dstStep, false, kernel, false );
+	}
+
+	void DemosaicRGB16( const void * src, int srcStep, int width, int height, int bitDepth, BayerPattern pattern, uint16_t * dst, int dstStep, DemosaicKernel kernel ) {
+		demosaic( src, srcStep, width, height, bitDepth, pattern, dst, dstStep, true, kernel, false );
+	}
+
+	void DemosaicReference( const void * src, int srcStep, int width, int height, int bitDepth, BayerPattern pattern, void * dst, int dstStep, bool rgb16 ) {
+		demosaic( src, srcStep, width, height, bitDepth, pattern, dst, dstStep, rgb16, DEMOSAIC_SCALAR, true );
+	}
+
+	DemosaicKernel GetDemosaicKernel() {
+#ifdef OFXARAVIS_X86
+		static DemosaicKernel best = [] {
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports( "avx2" )) return DEMOSAIC_AVX2;
+			if (__builtin_cpu_supports( "sse4.1" )) return DEMOSAIC_SSE41;
+			return DEMOSAIC_SCALAR;
+		}();
+		return best;
+#else
+		return DEMOSAIC_SCALAR;
+#endif
+	}
+
+	std::string DemosaicKernelToString( DemosaicKernel kernel ) {
+		switch (kernel) {
+			case DEMOSAIC_SCALAR: return "scalar";
+			case DEMOSAIC_SSE41: return "sse4.1";
+			case DEMOSAIC_AVX2: return "avx2";
+			default: return "auto";
+		}
+	}
+
+}
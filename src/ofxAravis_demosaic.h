@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace ofxAravis {
+
+    // ------- DEMOSAIC -------
+
+    // Colour of the top-left 2x2 cell, GenICam naming (BayerRG8 = BAYER_RG).
+    enum BayerPattern {
+        BAYER_RG,
+        BAYER_GB,
+        BAYER_GR,
+        BAYER_BG
+    };
+
+    enum DemosaicKernel {
+        DEMOSAIC_AUTO, // best kernel this CPU supports
+        DEMOSAIC_SCALAR,
+        DEMOSAIC_SSE41,
+        DEMOSAIC_AVX2
+    };
+
+    // Bilinear demosaic straight to interleaved RGB. src holds 8-bit samples when bitDepth == 8,
+    // otherwise LSB aligned 16-bit containers (10, 12, 14 or 16-bit samples). Steps are in bytes.
+    // RGB8 keeps the top 8 bits of each sample, RGB16 is scaled up to the full 16-bit range.
+    // Borders are mirrored, width and height must be at least 2.
+
+    void DemosaicRGB8( const void * src, int srcStep, int width, int height, int bitDepth, BayerPattern pattern, uint8_t * dst, int dstStep, DemosaicKernel kernel = DEMOSAIC_AUTO );
+    void DemosaicRGB16( const void * src, int srcStep, int width, int height, int bitDepth, BayerPattern pattern, uint16_t * dst, int dstStep, DemosaicKernel kernel = DEMOSAIC_AUTO );
+
+    // Plain per-pixel implementation, every kernel has to match it bit for bit.
+    void DemosaicReference( const void * src, int srcStep, int width, int height, int bitDepth, BayerPattern pattern, void * dst, int dstStep, bool rgb16 );
+
+    DemosaicKernel GetDemosaicKernel();
+    std::string DemosaicKernelToString( DemosaicKernel kernel );
+
+}
@@ -0,0 +1,205 @@
+#include "ofxAravis_discovery.h"
+
+#include <chrono>
+
+namespace ofxAravis {
+
+	namespace {
+
+		uint64_t Now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+		}
+
+		std::string safe( const char * chars ) {
+			return chars ? chars : "";
+		}
+
+		bool contains( const std::vector<Device> & devices, const std::string & id ) {
+			for (auto & device : devices) if (device.id == id) return true;
+			return false;
+		}
+
+	}
+
+	Device GetDeviceInfo( int idx ) {
+
+		ofxAravis::Device device;
+
+		device.id = safe( arv_get_device_id(idx) );
+		device.physical_id = safe( arv_get_device_physical_id(idx) );
+		device.address = safe( arv_get_device_address(idx) );
+		device.vendor = safe( arv_get_device_vendor(idx) );
+		device.manufacturer_info = safe( arv_get_device_manufacturer_info(idx) );
+		device.model = safe( arv_get_device_model(idx) );
+		device.serial_nbr = safe( arv_get_device_serial_nbr(idx) );
+		device.protocol = safe( arv_get_device_protocol(idx) );
+
+		return device;
+	}
+
+	std::shared_mutex & GetDeviceListMutex() {
+		static std::shared_mutex mutex;
+		return mutex;
+	}
+
+	// ------- DISCOVERY -------
+
+	DiscoveryService::~DiscoveryService() {
+		stop();
+	}
+
+	void DiscoveryService::setSettings( DiscoverySettings s ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		settings = s;
+		wake.notify_all();
+	}
+
+	void DiscoveryService::start() {
+		std::lock_guard<std::mutex> lock( mutex );
+		if (running) return;
+		running = true;
+		thread = std::thread( &DiscoveryService::threadedFunction, this );
+	}
+
+	void DiscoveryService::stop() {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (!running) return;
+			running = false;
+		}
+		wake.notify_all();
+		if (thread.joinable()) thread.join();
+	}
+
+	bool DiscoveryService::isRunning() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return running;
+	}
+
+	std::vector<Device> DiscoveryService::scan() {
+
+		std::vector<Device> found;
+		std::vector<DeviceEvent> events;
+		{
+			// held through the comparison too, so overlapping scans report changes in order
+			std::unique_lock<std::shared_mutex> list( GetDeviceListMutex() );
+			arv_update_device_list();
+			for (int i = 0; i < int( arv_get_n_devices() ); i++) found.push_back( GetDeviceInfo( i ) );
+
+			std::lock_guard<std::mutex> lock( mutex );
+			for (auto & device : found) {
+				if (!contains( devices, device.id )) events.push_back( { device, true } );
+			}
+			for (auto & device : devices) {
+				if (!contains( found, device.id )) events.push_back( { device, false } );
+			}
+			devices = found;
+			scanned = Now();
+			for (auto it = missed.begin(); it != missed.end();) {
+				if ((scanned - it->second) / 1e9 >= settings.ttl) it = missed.erase( it );
+				else ++it;
+			}
+		}
+
+		if (!events.empty()) {
+			// called on copies, so a listener can add or remove listeners, itself included
+			std::map<int, Listener> called;
+			{
+				std::lock_guard<std::mutex> lock( listenerMutex );
+				called = listeners;
+			}
+			for (auto & event : events) {
+				ofLogNotice("ofxAravis") << "DiscoveryService: " << (event.added ? "added " : "removed ") << event.device.id;
+				for (auto & listener : called) listener.second( event );
+			}
+		}
+
+		return found;
+	}
+
+	std::future<std::vector<Device>> DiscoveryService::scanAsync() {
+		return std::async( std::launch::async, [this] { return scan(); } );
+	}
+
+	std::vector<Device> DiscoveryService::getDevices() {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (scanned != 0 && (Now() - scanned) / 1e9 < settings.ttl) return devices;
+		}
+		return scan();
+	}
+
+	bool DiscoveryService::lookup( const std::string & name, Device & device ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		for (auto & candidate : devices) {
+			if (name == candidate.serial_nbr || name == candidate.physical_id || name == candidate.address || name == candidate.id) {
+				device = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool DiscoveryService::find( const std::string & name, Device & device ) {
+
+		bool fresh = isFresh();
+		if (fresh && lookup( name, device )) return true;
+
+		// a name a scan didn't find waits for the TTL before it costs another one
+		if (fresh) {
+			std::lock_guard<std::mutex> lock( mutex );
+			auto it = missed.find( name );
+			if (it != missed.end() && (Now() - it->second) / 1e9 < settings.ttl) return false;
+		}
+
+		scan();
+		if (lookup( name, device )) return true;
+
+		std::lock_guard<std::mutex> lock( mutex );
+		missed[name] = Now();
+		return false;
+	}
+
+	bool DiscoveryService::isFresh() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return scanned != 0 && (Now() - scanned) / 1e9 < settings.ttl;
+	}
+
+	double DiscoveryService::getAge() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return scanned == 0 ? -1 : (Now() - scanned) / 1e9;
+	}
+
+	int DiscoveryService::addListener( Listener listener ) {
+		std::lock_guard<std::mutex> lock( listenerMutex );
+		int id = nextListener++;
+		listeners[id] = listener;
+		return id;
+	}
+
+	void DiscoveryService::removeListener( int id ) {
+		std::lock_guard<std::mutex> lock( listenerMutex );
+		listeners.erase( id );
+	}
+
+	void DiscoveryService::threadedFunction() {
+
+		std::unique_lock<std::mutex> lock( mutex );
+
+		while (running) {
+
+			lock.unlock();
+			scan();
+			lock.lock();
+
+			auto interval = std::chrono::duration<double>( std::max( settings.interval, 0.1 ) );
+			wake.wait_for( lock, interval, [this] { return !running; } );
+		}
+	}
+
+	DiscoveryService & GetDiscoveryService() {
+		static DiscoveryService service;
+		return service;
+	}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <arv.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <future>
+#include <map>
+#include <condition_variable>
+
+namespace ofxAravis {
+
+    struct Device {
+        std::string id;
+        std::string physical_id; // MAC address for GigE Vision
+        std::string address;
+        std::string vendor;
+        std::string manufacturer_info;
+        std::string model;
+        std::string serial_nbr;
+        std::string protocol;
+    };
+
+    Device GetDeviceInfo( int idx ); // from the last scan, hold GetDeviceListMutex() around it
+
+    // Aravis keeps one device list per process: scans lock it exclusively, opening a device
+    // (arv_camera_new looks it up there) shared, so cameras still open in parallel
+    std::shared_mutex & GetDeviceListMutex();
+
+    // ------- DISCOVERY -------
+
+    // The process wide device list behind a cache. GigE discovery waits on every interface, so a
+    // scan can take seconds on hosts with several NICs; getDevices() and find() answer from the
+    // last scan while it is younger than the TTL, and a background thread can keep it fresh and
+    // report cameras coming and going. Listeners run on whichever thread scanned, outside every
+    // lock, so they may add and remove listeners.
+
+    struct DiscoverySettings {
+        double ttl = 5; // s a scan answers getDevices() and find()
+        double interval = 2; // s between background scans once started
+    };
+
+    struct DeviceEvent {
+        Device device;
+        bool added = true; // false = removed
+    };
+
+    class DiscoveryService {
+        public:
+            using Listener = std::function<void(const DeviceEvent & event)>;
+
+            ~DiscoveryService();
+
+            void setSettings( DiscoverySettings settings );
+            void start(); // background scans every interval
+            void stop();
+            bool isRunning();
+
+            std::vector<Device> scan(); // now, blocking
+            std::future<std::vector<Device>> scanAsync();
+            std::vector<Device> getDevices(); // cached, scans when older than the TTL
+
+            // by serial number, physical id (MAC), address or device id; scans again once when the
+            // cache is stale or doesn't know the name, a name that scan didn't find either answers
+            // false from the cache until the TTL has passed
+            bool find( const std::string & name, Device & device );
+
+            bool isFresh();
+            double getAge(); // s since the last scan, -1 before the first
+
+            int addListener( Listener listener ); // id for removeListener
+            void removeListener( int id ); // a scan already reporting may still call it with that scan's events
+
+        private:
+            bool lookup( const std::string & name, Device & device );
+            void threadedFunction();
+
+            DiscoverySettings settings;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::vector<Device> devices;
+            uint64_t scanned = 0; // steady clock ns, 0 = never
+            std::map<std::string, uint64_t> missed; // name -> when find() scanned for it in vain
+            bool running = false;
+            std::thread thread;
+
+            std::mutex listenerMutex;
+            std::map<int, Listener> listeners;
+            int nextListener = 1;
+    };
+
+    DiscoveryService & GetDiscoveryService(); // the one every Grabber and Camera looks devices up in
+
+}
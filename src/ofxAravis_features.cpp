@@ -0,0 +1,493 @@
+#include "ofxAravis_features.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace ofxAravis {
+
+	// ------- FEATURE HANDLES -------
+
+	std::string FeatureTypeToString( FeatureType type ) {
+		switch (type) {
+			case FEATURE_INTEGER: return "integer";
+			case FEATURE_FLOAT: return "float";
+			case FEATURE_BOOLEAN: return "boolean";
+			case FEATURE_STRING: return "string";
+			case FEATURE_ENUMERATION: return "enumeration";
+			case FEATURE_COMMAND: return "command";
+			default: return "unknown";
+		}
+	}
+
+	FeatureType GetFeatureType( ArvGcNode * node ) {
+
+		// enumerations also implement the integer and string interfaces, so they go first
+
+		if (ARV_IS_GC_ENUMERATION( node )) return FEATURE_ENUMERATION;
+		if (ARV_IS_GC_INTEGER( node )) return FEATURE_INTEGER;
+		if (ARV_IS_GC_FLOAT( node )) return FEATURE_FLOAT;
+		if (ARV_IS_GC_BOOLEAN( node )) return FEATURE_BOOLEAN;
+		if (ARV_IS_GC_STRING( node )) return FEATURE_STRING;
+		if (ARV_IS_GC_COMMAND( node )) return FEATURE_COMMAND;
+		return FEATURE_UNKNOWN;
+	}
+
+	// ------- FEATURE CACHE -------
+
+	namespace {
+
+		bool addName( ArvGcNode * node, std::vector<std::string> & names ) {
+			const char * name = ARV_IS_GC_FEATURE_NODE( node ) ? arv_gc_feature_node_get_name( ARV_GC_FEATURE_NODE( node ) ) : nullptr;
+			if (!name || std::find( names.begin(), names.end(), name ) != names.end()) return false;
+			names.push_back( name );
+			return true;
+		}
+
+		// the features a node's value is computed from, through pValue, pVariable and the like.
+		// Ports, selectors and availability don't carry a value, depth stops on cyclic documents
+
+		void collectInputs( ArvGcNode * node, std::vector<std::string> & names, int depth ) {
+			if (depth > 8) return;
+			for (ArvDomNode * child = arv_dom_node_get_first_child( ARV_DOM_NODE( node ) ); child; child = arv_dom_node_get_next_sibling( child )) {
+				if (!ARV_IS_GC_PROPERTY_NODE( child )) continue;
+				switch (arv_gc_property_node_get_node_type( ARV_GC_PROPERTY_NODE( child ) )) {
+					case ARV_GC_PROPERTY_NODE_TYPE_P_PORT:
+					case ARV_GC_PROPERTY_NODE_TYPE_P_SELECTED:
+					case ARV_GC_PROPERTY_NODE_TYPE_P_IS_AVAILABLE:
+					case ARV_GC_PROPERTY_NODE_TYPE_P_IS_IMPLEMENTED:
+					case ARV_GC_PROPERTY_NODE_TYPE_P_IS_LOCKED:
+						continue;
+					default:
+						break;
+				}
+				ArvGcNode * linked = arv_gc_property_node_get_linked_node( ARV_GC_PROPERTY_NODE( child ) );
+				if (!linked) continue;
+				addName( linked, names );
+				collectInputs( linked, names, depth + 1 );
+			}
+		}
+
+		std::vector<std::string> boundsInputsOf( ArvGcNode * node ) {
+			std::vector<std::string> names;
+			for (ArvDomNode * child = arv_dom_node_get_first_child( ARV_DOM_NODE( node ) ); child; child = arv_dom_node_get_next_sibling( child )) {
+				if (!ARV_IS_GC_PROPERTY_NODE( child )) continue;
+				ArvGcPropertyNodeType type = arv_gc_property_node_get_node_type( ARV_GC_PROPERTY_NODE( child ) );
+				bool bound = type == ARV_GC_PROPERTY_NODE_TYPE_P_MINIMUM || type == ARV_GC_PROPERTY_NODE_TYPE_P_MAXIMUM || type == ARV_GC_PROPERTY_NODE_TYPE_P_INCREMENT;
+				if (!bound && type != ARV_GC_PROPERTY_NODE_TYPE_P_INVALIDATOR) continue;
+				ArvGcNode * linked = arv_gc_property_node_get_linked_node( ARV_GC_PROPERTY_NODE( child ) );
+				if (!linked) continue;
+				addName( linked, names );
+				if (bound) collectInputs( linked, names, 0 );
+			}
+			return names;
+		}
+	}
+
+	void FeatureCache::setCamera( ArvCamera * c ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		camera = c;
+		handles.clear();
+		boundsDependents.clear();
+		staleBounds.clear();
+	}
+
+	void FeatureCache::clear() {
+		std::lock_guard<std::mutex> lock( mutex );
+		handles.clear();
+		boundsDependents.clear();
+		staleBounds.clear();
+	}
+
+	void FeatureCache::invalidateBounds() {
+		std::lock_guard<std::mutex> lock( mutex );
+		for (auto & entry : handles) {
+			if (entry.second->hasBounds) staleBounds.insert( entry.first );
+		}
+	}
+
+	void FeatureCache::invalidateBounds( const std::string & written ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		auto it = boundsDependents.find( written );
+		if (it == boundsDependents.end()) return;
+		for (auto & name : it->second) staleBounds.insert( name );
+	}
+
+	void FeatureCache::describe( FeatureHandle & handle ) {
+
+		ArvGcNode * node = handle.node;
+		ArvGcFeatureNode * feature = ARV_GC_FEATURE_NODE( node );
+		GError * err = nullptr;
+
+		handle.accessMode = arv_gc_feature_node_get_actual_access_mode( feature );
+
+		handle.type = GetFeatureType( node );
+
+		if (handle.type == FEATURE_INTEGER) {
+			handle.integerMin = arv_gc_integer_get_min( ARV_GC_INTEGER( node ), &err );
+			handle.integerMax = arv_gc_integer_get_max( ARV_GC_INTEGER( node ), &err );
+			handle.integerIncrement = arv_gc_integer_get_inc( ARV_GC_INTEGER( node ), &err );
+			handle.min = double( handle.integerMin );
+			handle.max = double( handle.integerMax );
+			handle.increment = double( handle.integerIncrement );
+			const char * unit = arv_gc_integer_get_unit( ARV_GC_INTEGER( node ) );
+			handle.unit = unit ? unit : "";
+		} else if (handle.type == FEATURE_FLOAT) {
+			handle.min = arv_gc_float_get_min( ARV_GC_FLOAT( node ), &err );
+			handle.max = arv_gc_float_get_max( ARV_GC_FLOAT( node ), &err );
+			handle.increment = arv_gc_float_get_inc( ARV_GC_FLOAT( node ), &err );
+			const char * unit = arv_gc_float_get_unit( ARV_GC_FLOAT( node ) );
+			handle.unit = unit ? unit : "";
+		}
+
+		// bounds are informative, a feature whose bounds can't be read is still usable
+		handle.hasBounds = (handle.type == FEATURE_INTEGER || handle.type == FEATURE_FLOAT) && !err && handle.min <= handle.max;
+		g_clear_error( &err );
+	}
+
+	FeatureHandlePtr FeatureCache::resolve( const std::string & name ) {
+
+		auto handle = std::make_shared<FeatureHandle>();
+		handle->name = name;
+		ArvCamera * resolvedFrom = nullptr;
+
+		// the node lookup only walks the GenICam document, the map lock is enough for it
+
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+
+			auto it = handles.find( name );
+			if (it != handles.end()) return it->second->node ? it->second : nullptr;
+
+			if (!camera) return nullptr;
+			resolvedFrom = camera;
+
+			ArvDevice * device = arv_camera_get_device( camera );
+			ArvGcNode * node = device ? arv_device_get_feature( device, name.c_str() ) : nullptr;
+			if (node && ARV_IS_GC_FEATURE_NODE( node )) handle->node = node;
+		}
+
+		// describing reads access mode and bounds from the device, that is control traffic like
+		// any other. The camera is only swapped under the control lock, so it can't change after this check
+
+		std::unique_lock<std::recursive_mutex> guard( control, std::defer_lock );
+		if (handle->node) {
+			guard.lock();
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				if (camera != resolvedFrom) return nullptr;
+			}
+			describe( *handle );
+			if (handle->type == FEATURE_INTEGER || handle->type == FEATURE_FLOAT) handle->boundsInputs = boundsInputsOf( handle->node );
+		}
+
+		// misses are cached too, so an unsupported feature costs one lookup only.
+		// Whoever published first wins, everyone shares that handle
+
+		std::lock_guard<std::mutex> lock( mutex );
+		if (camera != resolvedFrom) return nullptr;
+		auto inserted = handles.emplace( name, handle );
+		if (inserted.second) {
+			for (auto & input : handle->boundsInputs) boundsDependents[input].push_back( name );
+		}
+		return inserted.first->second->node ? inserted.first->second : nullptr;
+	}
+
+	FeatureHandlePtr FeatureCache::refresh( const std::string & name ) {
+
+		FeatureHandlePtr resolved = resolve( name );
+		if (!resolved) return nullptr;
+
+		// a copy, whoever holds the old one keeps reading consistent bounds
+
+		std::lock_guard<std::recursive_mutex> guard( control );
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			auto it = handles.find( name );
+			if (it == handles.end() || it->second->node != resolved->node) return nullptr; // the camera changed meanwhile
+		}
+
+		auto handle = std::make_shared<FeatureHandle>( *resolved );
+		describe( *handle );
+
+		std::lock_guard<std::mutex> lock( mutex );
+		handles[name] = handle;
+		staleBounds.erase( name );
+		return handle;
+	}
+
+	FeatureHandlePtr FeatureCache::bounded( const std::string & name ) {
+		FeatureHandlePtr handle = resolve( name );
+		if (!handle) return nullptr;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (staleBounds.count( name ) == 0) return handle;
+		}
+		FeatureHandlePtr fresh = refresh( name );
+		return fresh ? fresh : handle;
+	}
+
+	FeatureHandlePtr FeatureCache::expect( const std::string & name, FeatureType type ) {
+
+		FeatureHandlePtr handle = resolve( name );
+		if (!handle) {
+			ofLogError("ofxAravis") << "Unknown feature: " << name;
+			return nullptr;
+		}
+
+		// enumerations implement both the string and the integer interface
+		bool matches = handle->type == type || (handle->type == FEATURE_ENUMERATION && (type == FEATURE_STRING || type == FEATURE_INTEGER));
+		if (!matches) {
+			ofLogError("ofxAravis") << "Feature " << name << " is " << FeatureTypeToString( handle->type ) << ", not " << FeatureTypeToString( type );
+			return nullptr;
+		}
+		return handle;
+	}
+
+	std::recursive_mutex & FeatureCache::getControlMutex() {
+		return control;
+	}
+
+	bool FeatureCache::setInteger( const std::string & name, gint64 value, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_INTEGER );
+		if (!handle) return false;
+		std::lock_guard<std::recursive_mutex> guard( control );
+		arv_gc_integer_set_value( ARV_GC_INTEGER( handle->node ), value, err );
+		invalidateBounds( name );
+		return !(err && *err);
+	}
+
+	gint64 FeatureCache::getInteger( const std::string & name, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_INTEGER );
+		if (!handle) return 0;
+		std::lock_guard<std::recursive_mutex> guard( control );
+		return arv_gc_integer_get_value( ARV_GC_INTEGER( handle->node ), err );
+	}
+
+	bool FeatureCache::setFloat( const std::string & name, double value, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_FLOAT );
+		if (!handle) return false;
+		std::lock_guard<std::recursive_mutex> guard( control );
+		arv_gc_float_set_value( ARV_GC_FLOAT( handle->node ), value, err );
+		invalidateBounds( name );
+		return !(err && *err);
+	}
+
+	double FeatureCache::getFloat( const std::string & name, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_FLOAT );
+		if (!handle) return 0;
+		std::lock_guard<std::recursive_mutex> guard( control );
+		return arv_gc_float_get_value( ARV_GC_FLOAT( handle->node ), err );
+	}
+
+	bool FeatureCache::setBoolean( const std::string & name, bool value, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_BOOLEAN );
+		if (!handle) return false;
+		std::lock_guard<std::recursive_mutex> guard( control );
+		arv_gc_boolean_set_value( ARV_GC_BOOLEAN( handle->node ), value, err );
+		invalidateBounds( name );
+		return !(err && *err);
+	}
+
+	bool FeatureCache::getBoolean( const std::string & name, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_BOOLEAN );
+		if (!handle) return false;
+		std::lock_guard<std::recursive_mutex> guard( control );
+		return arv_gc_boolean_get_value( ARV_GC_BOOLEAN( handle->node ), err );
+	}
+
+	bool FeatureCache::setString( const std::string & name, const std::string & value, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_STRING );
+		if (!handle) return false;
+		std::lock_guard<std::recursive_mutex> guard( control );
+		arv_gc_string_set_value( ARV_GC_STRING( handle->node ), value.c_str(), err );
+		invalidateBounds( name );
+		return !(err && *err);
+	}
+
+	std::string FeatureCache::getString( const std::string & name, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_STRING );
+		if (!handle) return "";
+		std::lock_guard<std::recursive_mutex> guard( control );
+		const char * value = arv_gc_string_get_value( ARV_GC_STRING( handle->node ), err );
+		return value ? value : "";
+	}
+
+	bool FeatureCache::execute( const std::string & name, GError ** err ) {
+		FeatureHandlePtr handle = expect( name, FEATURE_COMMAND );
+		if (!handle) return false;
+		std::lock_guard<std::recursive_mutex> guard( control );
+		arv_gc_command_execute( ARV_GC_COMMAND( handle->node ), err );
+		invalidateBounds( name );
+		return !(err && *err);
+	}
+
+	ofJson FeatureCache::getValue( const std::string & name, GError ** err ) {
+
+		FeatureHandlePtr handle = resolve( name );
+		if (!handle) return nullptr;
+
+		switch (handle->type) {
+			case FEATURE_INTEGER: return getInteger( name, err );
+			case FEATURE_FLOAT: return getFloat( name, err );
+			case FEATURE_BOOLEAN: return getBoolean( name, err );
+			case FEATURE_STRING:
+			case FEATURE_ENUMERATION: return getString( name, err );
+			default: return nullptr;
+		}
+	}
+
+	bool FeatureCache::setValue( const std::string & name, const ofJson & value, GError ** err ) {
+
+		FeatureHandlePtr handle = resolve( name );
+		if (!handle) {
+			ofLogError("ofxAravis") << "Unknown feature: " << name;
+			return false;
+		}
+
+		bool matches = false;
+		switch (handle->type) {
+			case FEATURE_INTEGER: matches = value.is_number(); break;
+			case FEATURE_FLOAT: matches = value.is_number(); break;
+			case FEATURE_BOOLEAN: matches = value.is_boolean() || value.is_number_integer(); break;
+			case FEATURE_STRING: matches = value.is_string(); break;
+			case FEATURE_ENUMERATION: matches = value.is_string() || value.is_number_integer(); break;
+			case FEATURE_COMMAND: matches = true; break;
+			default: break;
+		}
+		if (!matches) {
+			ofLogError("ofxAravis") << "Feature " << name << " is " << FeatureTypeToString( handle->type ) << ", can't set it to " << value.dump();
+			return false;
+		}
+
+		switch (handle->type) {
+			case FEATURE_INTEGER: return setInteger( name, value.is_number_float() ? gint64( std::llround( value.get<double>() ) ) : value.get<gint64>(), err );
+			case FEATURE_FLOAT: return setFloat( name, value.get<double>(), err );
+			case FEATURE_BOOLEAN: return setBoolean( name, value.is_boolean() ? value.get<bool>() : value.get<int>() != 0, err );
+			case FEATURE_COMMAND: return execute( name, err );
+			case FEATURE_ENUMERATION: return value.is_number_integer() ? setInteger( name, value.get<gint64>(), err ) : setString( name, value.get<std::string>(), err );
+			default: return setString( name, value.get<std::string>(), err );
+		}
+	}
+
+	// ------- TYPED ACCESS -------
+
+	namespace {
+		GQuark errorDomain() {
+			return g_quark_from_static_string( "ofxAravis" );
+		}
+	}
+
+	bool FeatureCache::checkInteger( const std::string & name, gint64 & value, bool clamp, GError ** err ) {
+
+		FeatureHandlePtr handle = bounded( name );
+		if (!handle || !handle->hasBounds) return true;
+
+		bool inside = value >= handle->integerMin && value <= handle->integerMax;
+
+		// offsets in unsigned, ranges like [INT64_MIN, INT64_MAX] overflow a signed difference
+		guint64 increment = guint64( std::max<gint64>( handle->integerIncrement, 1 ) );
+		bool aligned = increment == 1 || (guint64( value ) - guint64( handle->integerMin )) % increment == 0;
+
+		if (inside && aligned) return true;
+
+		if (!clamp) {
+			g_set_error( err, errorDomain(), 0, "%s: %lld is outside [%lld, %lld] step %lld", name.c_str(),
+				(long long) value, (long long) handle->integerMin, (long long) handle->integerMax, (long long) increment );
+			return false;
+		}
+
+		value = std::min( std::max( value, handle->integerMin ), handle->integerMax );
+		if (increment > 1) {
+			guint64 offset = guint64( value ) - guint64( handle->integerMin );
+			guint64 snapped = (offset + increment / 2) / increment * increment;
+			guint64 range = guint64( handle->integerMax ) - guint64( handle->integerMin );
+			if (snapped > range) snapped -= increment;
+			value = gint64( guint64( handle->integerMin ) + snapped );
+		}
+		return true;
+	}
+
+	bool FeatureCache::checkFloat( const std::string & name, double & value, bool clamp, GError ** err ) {
+
+		FeatureHandlePtr handle = bounded( name );
+		if (!handle || !handle->hasBounds) return true;
+
+		if (!std::isfinite( value )) {
+			g_set_error( err, errorDomain(), 0, "%s: %f is not a number", name.c_str(), value );
+			return false;
+		}
+
+		bool inside = value >= handle->min && value <= handle->max;
+		if (inside) return true;
+
+		if (!clamp) {
+			g_set_error( err, errorDomain(), 0, "%s: %f is outside [%f, %f]", name.c_str(), value, handle->min, handle->max );
+			return false;
+		}
+
+		value = std::min( std::max( value, handle->min ), handle->max );
+		return true;
+	}
+
+	bool FeatureCache::setNumber( const std::string & name, double real, gint64 integer, bool isIntegral, GError ** err, bool clamp ) {
+
+		FeatureHandlePtr handle = resolve( name );
+		if (!handle) {
+			g_set_error( err, errorDomain(), 0, "unknown feature %s", name.c_str() );
+			return false;
+		}
+
+		std::lock_guard<std::recursive_mutex> guard( control );
+
+		switch (handle->type) {
+			case FEATURE_INTEGER: {
+				gint64 value = isIntegral ? integer : gint64( std::llround( real ) );
+				if (!checkInteger( name, value, clamp, err )) return false;
+				return setInteger( name, value, err );
+			}
+			case FEATURE_FLOAT: {
+				double value = isIntegral ? double( integer ) : real;
+				if (!checkFloat( name, value, clamp, err )) return false;
+				return setFloat( name, value, err );
+			}
+			case FEATURE_BOOLEAN:
+				return setBoolean( name, isIntegral ? integer != 0 : real != 0, err );
+			case FEATURE_ENUMERATION:
+				// entry values aren't a range, the device refuses the ones it doesn't have
+				return setInteger( name, isIntegral ? integer : gint64( std::llround( real ) ), err );
+			default:
+				g_set_error( err, errorDomain(), 0, "%s is %s, not a number", name.c_str(), FeatureTypeToString( handle->type ).c_str() );
+				return false;
+		}
+	}
+
+	bool FeatureCache::getNumber( const std::string & name, double & real, gint64 & integer, bool & isIntegral, GError ** err ) {
+
+		FeatureHandlePtr handle = resolve( name );
+		if (!handle) {
+			g_set_error( err, errorDomain(), 0, "unknown feature %s", name.c_str() );
+			return false;
+		}
+
+		switch (handle->type) {
+			case FEATURE_INTEGER:
+			case FEATURE_ENUMERATION:
+				integer = getInteger( name, err );
+				isIntegral = true;
+				break;
+			case FEATURE_FLOAT:
+				real = getFloat( name, err );
+				isIntegral = false;
+				break;
+			case FEATURE_BOOLEAN:
+				integer = getBoolean( name, err ) ? 1 : 0;
+				isIntegral = true;
+				break;
+			default:
+				g_set_error( err, errorDomain(), 0, "%s is %s, not a number", name.c_str(), FeatureTypeToString( handle->type ).c_str() );
+				return false;
+		}
+		return !(err && *err);
+	}
+
+}
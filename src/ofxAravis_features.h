@@ -0,0 +1,160 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <arv.h>
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ofxAravis {
+
+    // ------- FEATURE HANDLES -------
+
+    // A GenICam feature resolved once: the node, its interface type, access mode and bounds.
+    // Node pointers stay valid as long as the camera they were resolved from. Handles are shared
+    // and never change once handed out, a refresh or setCamera() replaces them in the cache while
+    // callers keep the one they resolved.
+
+    enum FeatureType {
+        FEATURE_UNKNOWN,
+        FEATURE_INTEGER,
+        FEATURE_FLOAT,
+        FEATURE_BOOLEAN,
+        FEATURE_STRING,
+        FEATURE_ENUMERATION, // read and written as strings, or as integers through their values
+        FEATURE_COMMAND
+    };
+
+    struct FeatureHandle {
+        std::string name;
+        ArvGcNode * node = nullptr;
+        FeatureType type = FEATURE_UNKNOWN;
+        ArvGcAccessMode accessMode = ARV_GC_ACCESS_MODE_UNDEFINED;
+        double min = 0; // integer and float features, as read when resolved or refreshed
+        double max = 0;
+        double increment = 0;
+        gint64 integerMin = 0; // the same at full precision for integer features
+        gint64 integerMax = 0;
+        gint64 integerIncrement = 1;
+        bool hasBounds = false; // false when the device refused to report them
+        std::vector<std::string> boundsInputs; // features a write to which can move the bounds, through pMin, pMax, pInc or pInvalidator
+        std::string unit;
+
+        bool isReadable() const { return accessMode == ARV_GC_ACCESS_MODE_RO || accessMode == ARV_GC_ACCESS_MODE_RW; }
+        bool isWritable() const { return accessMode == ARV_GC_ACCESS_MODE_WO || accessMode == ARV_GC_ACCESS_MODE_RW; }
+    };
+
+    using FeatureHandlePtr = std::shared_ptr<const FeatureHandle>;
+
+    std::string FeatureTypeToString( FeatureType type );
+    FeatureType GetFeatureType( ArvGcNode * node ); // from the node class, no device access
+
+    // ------- FEATURE CACHE -------
+
+    // Name -> handle map shared by Grabber and Camera. The first access to a feature walks the
+    // GenICam DOM, every later read or write goes straight to the cached node.
+    // Errors from the device are returned through err, unknown or mistyped features are logged.
+
+    class FeatureCache {
+        public:
+            void setCamera( ArvCamera * camera ); // drops every handle, nullptr when the camera closes
+            void clear();
+
+            FeatureHandlePtr resolve( const std::string & name ); // nullptr when the camera has no such feature
+            FeatureHandlePtr refresh( const std::string & name ); // re-reads access mode and bounds, which can depend on other features
+
+            // bounds are re-read on the next checked write once marked stale. Writes through this cache
+            // mark the features that list the written one as a bounds input, other writes (arv_camera_*,
+            // registers, ApplyFeatures) have to mark them: everything, or what depends on one feature
+            void invalidateBounds();
+            void invalidateBounds( const std::string & written );
+            FeatureHandlePtr bounded( const std::string & name ); // resolve(), refreshed first when the bounds are stale
+
+            bool setInteger( const std::string & name, gint64 value, GError ** err ); // enumerations too, by entry value
+            gint64 getInteger( const std::string & name, GError ** err );
+
+            bool setFloat( const std::string & name, double value, GError ** err );
+            double getFloat( const std::string & name, GError ** err );
+
+            bool setBoolean( const std::string & name, bool value, GError ** err );
+            bool getBoolean( const std::string & name, GError ** err );
+
+            bool setString( const std::string & name, const std::string & value, GError ** err ); // strings and enumerations
+            std::string getString( const std::string & name, GError ** err );
+
+            bool execute( const std::string & name, GError ** err );
+
+            // any type through JSON: numbers, booleans, strings and enumeration entries by name,
+            // commands execute on any value. Null json when the feature can't be read.
+            ofJson getValue( const std::string & name, GError ** err );
+            bool setValue( const std::string & name, const ofJson & value, GError ** err );
+
+            // typed access at full gint64 / double precision. The GenICam interface follows the
+            // feature, not T: any arithmetic T reads and writes integer, float and boolean features,
+            // std::string strings and enumerations. Numbers are checked against the cached bounds
+            // before anything is sent; out of range they are clamped (and integers snapped to the
+            // increment), or with clamp = false refused with an error and no device traffic.
+            // The check never reads the device unless the bounds were marked stale, see invalidateBounds().
+            template<typename T> bool set( const std::string & name, const T & value, GError ** err, bool clamp = true );
+            template<typename T> T get( const std::string & name, GError ** err );
+
+            // held by every read and write above, lock it around other control traffic
+            // (arv_camera_* calls, background polling) that must not interleave with them
+            std::recursive_mutex & getControlMutex();
+
+        private:
+            FeatureHandlePtr expect( const std::string & name, FeatureType type );
+            void describe( FeatureHandle & handle ); // reads the device, call under the control lock and never under mutex
+
+            bool setNumber( const std::string & name, double real, gint64 integer, bool isIntegral, GError ** err, bool clamp );
+            bool getNumber( const std::string & name, double & real, gint64 & integer, bool & isIntegral, GError ** err );
+            bool checkInteger( const std::string & name, gint64 & value, bool clamp, GError ** err );
+            bool checkFloat( const std::string & name, double & value, bool clamp, GError ** err );
+
+            ArvCamera * camera = nullptr;
+            std::mutex mutex; // guards the map and the camera pointer, never held across device reads
+            std::recursive_mutex control;
+            std::unordered_map<std::string, FeatureHandlePtr> handles; // misses are cached as handles without a node
+            std::unordered_map<std::string, std::vector<std::string>> boundsDependents; // bounds input -> resolved features it moves
+            std::unordered_set<std::string> staleBounds;
+    };
+
+    template<typename T>
+    bool FeatureCache::set( const std::string & name, const T & value, GError ** err, bool clamp ) {
+        if constexpr (std::is_same<T, bool>::value) {
+            return setNumber( name, value ? 1 : 0, value ? 1 : 0, true, err, clamp );
+        } else if constexpr (std::is_convertible<T, std::string>::value) {
+            return setString( name, std::string( value ), err );
+        } else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+            return setNumber( name, double( value ), gint64( value ), true, err, clamp );
+        } else {
+            static_assert( std::is_floating_point<T>::value, "FeatureCache::set takes numbers, bools and strings" );
+            return setNumber( name, double( value ), 0, false, err, clamp );
+        }
+    }
+
+    template<typename T>
+    T FeatureCache::get( const std::string & name, GError ** err ) {
+        if constexpr (std::is_same<T, std::string>::value) {
+            ofJson value = getValue( name, err );
+            if (value.is_string()) return value.get<std::string>();
+            return value.is_null() ? "" : value.dump();
+        } else {
+            static_assert( std::is_arithmetic<T>::value, "FeatureCache::get returns numbers, bools and strings" );
+            double real = 0;
+            gint64 integer = 0;
+            bool isIntegral = false;
+            if (!getNumber( name, real, integer, isIntegral, err )) return T();
+            if constexpr (std::is_same<T, bool>::value) return isIntegral ? integer != 0 : real != 0;
+            else return isIntegral ? static_cast<T>( integer ) : static_cast<T>( real );
+        }
+    }
+
+}
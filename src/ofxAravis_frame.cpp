@@ -0,0 +1,150 @@
+#include "ofxAravis_frame.h"
+#include "ofxAravis_buffers.h"
+
+namespace ofxAravis {
+
+	// ------- FRAME -------
+
+	FrameLease LeaseBuffer( ArvStream * stream, ArvBuffer * buffer ) {
+
+		Frame * frame = new Frame();
+
+		size_t size = 0;
+		frame->data = const_cast<uint8_t *>( static_cast<const uint8_t *>( arv_buffer_get_data( buffer, &size ) ) );
+		frame->size = size;
+		frame->width = arv_buffer_get_image_width( buffer );
+		frame->height = arv_buffer_get_image_height( buffer );
+		frame->pixelFormat = arv_buffer_get_image_pixel_format( buffer );
+		frame->step = frame->width * ARV_PIXEL_FORMAT_BIT_PER_PIXEL( frame->pixelFormat ) / 8;
+		frame->frameId = arv_buffer_get_frame_id( buffer );
+		frame->timestamp = arv_buffer_get_timestamp( buffer );
+		frame->systemTimestamp = arv_buffer_get_system_timestamp( buffer );
+
+		// the lease keeps the stream alive so the buffer always has somewhere to go back to,
+		// and is counted against the arena so the pool doesn't reuse the memory under it
+
+		g_object_ref( stream );
+		std::shared_ptr<BufferArena> arena = ArenaOf( buffer );
+		if (arena) arena->leases += 1;
+
+		return FrameLease( frame, [stream, buffer, arena]( const Frame * f ) {
+			arv_stream_push_buffer( stream, buffer );
+			if (arena) arena->leases -= 1;
+			g_object_unref( stream );
+			delete f;
+		});
+	}
+
+	void CopyFrameInfo( const Frame & from, Frame & to ) {
+		to.frameId = from.frameId;
+		to.timestamp = from.timestamp;
+		to.systemTimestamp = from.systemTimestamp;
+	}
+
+	guint64 HostTimestamp() {
+		return guint64( g_get_real_time() ) * 1000;
+	}
+
+	// ------- FRAME IDS -------
+
+	void FrameIdTracker::reset() {
+		started = false;
+		received = 0;
+		dropped = 0;
+		resets = 0;
+		last = 0;
+	}
+
+	uint64_t FrameIdTracker::update( guint64 frameId ) {
+
+		guint64 previous = last;
+		last = frameId;
+		received += 1;
+
+		if (!started) {
+			started = true;
+			return 0;
+		}
+
+		uint64_t missing = 0;
+
+		if (frameId > previous) {
+			missing = frameId - previous - 1;
+		} else if (previous > 0xFF00 && previous <= 0xFFFF && frameId < 0x100) {
+			// 16-bit wrap, 0 is never sent so ..., 65534, 65535, 1, 2 has no gap
+			missing = (0xFFFF - previous) + (frameId > 0 ? frameId - 1 : 0);
+		} else if (frameId < previous) {
+			resets += 1;
+		}
+
+		dropped += missing;
+		return missing;
+	}
+
+	uint64_t FrameIdTracker::getReceived() {
+		return received;
+	}
+
+	uint64_t FrameIdTracker::getDropped() {
+		return dropped;
+	}
+
+	uint64_t FrameIdTracker::getResets() {
+		return resets;
+	}
+
+	guint64 FrameIdTracker::getLastFrameId() {
+		return last;
+	}
+
+	// ------- FRAME POOL -------
+
+	FramePool::FramePool() : storage( std::make_shared<Storage>() ) {
+	}
+
+	FramePool::Storage::~Storage() {
+		for (auto * memory : free) delete memory;
+	}
+
+	std::shared_ptr<Frame> FramePool::acquire( size_t size ) {
+
+		std::vector<uint8_t> * memory = nullptr;
+		{
+			std::lock_guard<std::mutex> lock( storage->mutex );
+			if (!storage->free.empty()) {
+				memory = storage->free.back();
+				storage->free.pop_back();
+			} else {
+				storage->allocated += 1;
+			}
+		}
+
+		if (!memory) memory = new std::vector<uint8_t>();
+
+		// only reallocates when the frame size changes
+
+		if (memory->size() != size) memory->resize( size );
+
+		Frame * frame = new Frame();
+		frame->data = memory->data();
+		frame->size = size;
+
+		auto owner = storage;
+		return std::shared_ptr<Frame>( frame, [owner, memory]( Frame * f ) {
+			std::lock_guard<std::mutex> lock( owner->mutex );
+			owner->free.push_back( memory );
+			delete f;
+		});
+	}
+
+	size_t FramePool::getAllocatedCount() {
+		std::lock_guard<std::mutex> lock( storage->mutex );
+		return storage->allocated;
+	}
+
+	size_t FramePool::getFreeCount() {
+		std::lock_guard<std::mutex> lock( storage->mutex );
+		return storage->free.size();
+	}
+
+}
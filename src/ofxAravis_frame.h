@@ -0,0 +1,95 @@
+#pragma once
+
+#include <arv.h>
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <functional>
+
+namespace ofxAravis {
+
+    // ------- FRAME -------
+
+    // A frame is either a camera buffer still owned by the stream, or an output
+    // buffer taken from a FramePool. Consumers must not write into leased camera buffers.
+
+    struct Frame {
+        uint8_t * data = nullptr;
+        size_t size = 0;
+        int width = 0;
+        int height = 0;
+        int step = 0; // bytes per row
+        ArvPixelFormat pixelFormat = 0;
+
+        guint64 frameId = 0; // GigE Vision block id or USB3 Vision block id, as sent by the camera
+        guint64 timestamp = 0; // device clock in ns, 0 when the camera doesn't stamp frames
+        guint64 systemTimestamp = 0; // host wall clock in ns when the last packet arrived, see HostTimestamp()
+    };
+
+    // Copies frame id and timestamps, so converted frames keep the identity of their raw frame.
+
+    void CopyFrameInfo( const Frame & from, Frame & to );
+
+    // Host wall clock in ns, the same clock Aravis uses for Frame::systemTimestamp.
+
+    guint64 HostTimestamp();
+
+    // Refcounted handle: the underlying memory is recycled when the last copy is released.
+
+    using FrameLease = std::shared_ptr<const Frame>;
+    using FrameCallback = std::function<void(const FrameLease&)>;
+
+    // Wraps an ArvBuffer popped from the stream. The buffer is pushed back to the
+    // stream through arv_stream_push_buffer only when the last lease is released.
+    // Buffers from a BufferPool also count the lease against their arena, see BufferArena.
+
+    FrameLease LeaseBuffer( ArvStream * stream, ArvBuffer * buffer );
+
+    // ------- FRAME IDS -------
+
+    // Counts frames missing from the sequence of ids. GigE Vision 1.x ids are 16-bit and skip 0
+    // when they wrap, extended ids and USB3 Vision ids are 64-bit. An id going backwards any other
+    // way means the camera restarted counting, which is counted as a reset rather than a drop.
+    // update() is called from the stream thread only, the counters can be read from anywhere.
+
+    class FrameIdTracker {
+        public:
+            void reset();
+            uint64_t update( guint64 frameId ); // returns the number of frames missing before this one
+
+            uint64_t getReceived();
+            uint64_t getDropped();
+            uint64_t getResets();
+            guint64 getLastFrameId();
+
+        private:
+            bool started = false;
+            std::atomic<uint64_t> received { 0 };
+            std::atomic<uint64_t> dropped { 0 };
+            std::atomic<uint64_t> resets { 0 };
+            std::atomic<guint64> last { 0 };
+    };
+
+    // ------- FRAME POOL -------
+
+    class FramePool {
+        public:
+            FramePool();
+
+            std::shared_ptr<Frame> acquire( size_t size );
+            size_t getAllocatedCount();
+            size_t getFreeCount();
+
+        private:
+            struct Storage {
+                std::mutex mutex;
+                std::vector<std::vector<uint8_t> *> free;
+                size_t allocated = 0;
+                ~Storage();
+            };
+            std::shared_ptr<Storage> storage;
+    };
+
+}
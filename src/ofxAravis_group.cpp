@@ -0,0 +1,186 @@
+#include "ofxAravis_group.h"
+
+#include <thread>
+#include <algorithm>
+
+namespace ofxAravis {
+
+	namespace {
+
+		bool matches( const Device & device, const std::string & camera ) {
+			return camera == device.id || camera == device.serial_nbr || camera == device.physical_id;
+		}
+
+		// the main (GL) thread keeps a core, stream threads mostly wait on the socket so four share one
+		int defaultWorkers( size_t cameras ) {
+			int cores = std::max( 1, int( std::thread::hardware_concurrency() ) );
+			return std::max( 1, cores - 1 - int( (cameras + 3) / 4 ) );
+		}
+
+	}
+
+	// ------- CAMERA GROUP -------
+
+	CameraGroup::~CameraGroup() {
+		close();
+	}
+
+	void CameraGroup::setSettings( CameraGroupSettings s ) {
+		settings = s;
+	}
+
+	size_t CameraGroup::open( const std::vector<std::string> & cameras ) {
+
+		close();
+
+		// one lookup for the whole group, a scan only when the cached one is stale
+
+		std::vector<Device> found = GetDiscoveryService().getDevices();
+		std::vector<char> present;
+
+		if (cameras.empty()) {
+			devices = found;
+			present.assign( devices.size(), 1 );
+		} else {
+			for (auto & camera : cameras) {
+				auto it = std::find_if( found.begin(), found.end(), [&]( const Device & device ) { return matches( device, camera ); } );
+				if (it == found.end()) {
+					ofLogError("ofxAravis") << "CameraGroup: no device " << camera;
+					Device missing;
+					missing.id = camera;
+					devices.push_back( missing );
+					present.push_back( 0 );
+				} else {
+					devices.push_back( *it );
+					present.push_back( 1 );
+				}
+			}
+		}
+
+		if (devices.empty()) return 0;
+
+		workers.start( settings.workers > 0 ? settings.workers : defaultWorkers( devices.size() ) );
+
+		// constructed here, they register for the exit event from the main thread
+		for (size_t i = 0; i < devices.size(); i++) {
+			grabbers.emplace_back( new Grabber() );
+			grabbers.back()->setWorkerPool( &workers );
+		}
+		opened.assign( devices.size(), 0 );
+
+		std::atomic<size_t> next { 0 };
+		auto openNext = [&] {
+			for (size_t i = next++; i < devices.size(); i = next++) {
+				if (!present[i]) continue;
+				if (settings.configure) settings.configure( *grabbers[i], devices[i] );
+				if (settings.synchronizer) {
+					// after any frame callback configure set, which still gets its frames
+					FrameCallback own = grabbers[i]->frameCallback;
+					FrameCallback sync = settings.synchronizer->getCallback( int( i ) );
+					grabbers[i]->setFrameCallback( [own, sync]( const FrameLease & frame ) {
+						if (own) own( frame );
+						sync( frame );
+					});
+				}
+				opened[i] = grabbers[i]->setup( devices[i] );
+			}
+		};
+
+		int threads = std::max( 1, std::min( settings.openThreads, int( devices.size() ) ) );
+		std::vector<std::thread> openers;
+		for (int i = 1; i < threads; i++) openers.emplace_back( openNext );
+		openNext();
+		for (auto & opener : openers) opener.join();
+
+		size_t count = std::count( opened.begin(), opened.end(), 1 );
+		ofLogNotice("ofxAravis") << "CameraGroup: opened " << count << " of " << devices.size() << " cameras, " << workers.getWorkerCount() << " conversion workers";
+		return count;
+	}
+
+	void CameraGroup::close() {
+		grabbers.clear(); // each stops its stream and conversions
+		workers.stop();
+		devices.clear();
+		opened.clear();
+	}
+
+	size_t CameraGroup::size() {
+		return grabbers.size();
+	}
+
+	Grabber & CameraGroup::get( size_t index ) {
+		return *grabbers.at( index );
+	}
+
+	const Device & CameraGroup::getDevice( size_t index ) {
+		return devices.at( index );
+	}
+
+	bool CameraGroup::isOpen( size_t index ) {
+		return index < opened.size() && opened[index];
+	}
+
+	int CameraGroup::find( const std::string & camera ) {
+		for (size_t i = 0; i < devices.size(); i++) {
+			if (matches( devices[i], camera )) return int( i );
+		}
+		return -1;
+	}
+
+	void CameraGroup::update() {
+		for (size_t i = 0; i < grabbers.size(); i++) {
+			if (opened[i]) grabbers[i]->update();
+		}
+	}
+
+	WorkerPool & CameraGroup::getWorkerPool() {
+		return workers;
+	}
+
+	CameraGroupStats CameraGroup::getStats() {
+
+		CameraGroupStats stats;
+		stats.workers = workers.getWorkerCount();
+		stats.pending = workers.getPending();
+
+		for (size_t i = 0; i < grabbers.size(); i++) {
+
+			StatsSnapshot snapshot;
+			double megapixels = 0;
+
+			if (opened[i]) {
+				snapshot = grabbers[i]->getStats();
+				megapixels = snapshot.fps * grabbers[i]->getActiveWidth() * grabbers[i]->getActiveHeight() / 1e6;
+			}
+
+			stats.ids.push_back( devices[i].id );
+			stats.cameras.push_back( snapshot );
+			stats.megapixelsPerSecond.push_back( megapixels );
+			stats.fps += snapshot.fps;
+			stats.totalMegapixelsPerSecond += megapixels;
+			stats.frames += snapshot.frames;
+			stats.dropped += snapshot.dropped;
+		}
+
+		return stats;
+	}
+
+	ofJson CameraGroupStats::toJson() const {
+		ofJson json;
+		json["fps"] = fps;
+		json["megapixelsPerSecond"] = totalMegapixelsPerSecond;
+		json["frames"] = frames;
+		json["dropped"] = dropped;
+		json["pending"] = pending;
+		json["workers"] = workers;
+		json["cameras"] = ofJson::array();
+		for (size_t i = 0; i < cameras.size(); i++) {
+			ofJson camera = cameras[i].toJson();
+			camera["id"] = ids[i];
+			camera["megapixelsPerSecond"] = megapixelsPerSecond[i];
+			json["cameras"].push_back( camera );
+		}
+		return json;
+	}
+
+}
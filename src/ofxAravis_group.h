@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ofxAravis.h"
+
+namespace ofxAravis {
+
+    // ------- CAMERA GROUP -------
+
+    // Several Grabbers opened and run together. The device list is scanned once, then the
+    // cameras are set up a few at a time in parallel (XML download, stream creation). Conversion
+    // and frame callbacks of every camera run on one shared WorkerPool, so adding a camera adds
+    // its Aravis stream thread but never more conversion threads.
+
+    struct CameraGroupSettings {
+        int workers = 0; // shared conversion threads, 0 = sized from the cores and the camera count, see open()
+        int openThreads = 4; // cameras set up at once
+        std::function<void(Grabber & grabber, const Device & device)> configure; // before each setup, on an opening thread
+        FrameSynchronizer * synchronizer = nullptr; // gets every camera's frames as stream = group index, set up with one stream per camera
+    };
+
+    struct CameraGroupStats {
+        std::vector<std::string> ids;
+        std::vector<StatsSnapshot> cameras; // same order as the group, empty for cameras that failed to open
+        std::vector<double> megapixelsPerSecond;
+        double fps = 0; // summed over the cameras
+        double totalMegapixelsPerSecond = 0;
+        uint64_t frames = 0;
+        uint64_t dropped = 0;
+        size_t pending = 0; // conversions waiting for a shared worker
+        int workers = 0;
+
+        ofJson toJson() const;
+    };
+
+    class CameraGroup {
+        public:
+            ~CameraGroup();
+
+            void setSettings( CameraGroupSettings settings ); // call before open
+
+            // ids, serial numbers or physical ids (MAC) as ListAllDevices reports them, empty = every
+            // device found. Returns how many opened, the others stay in the group with isOpen() false.
+            size_t open( const std::vector<std::string> & cameras = {} );
+            void close();
+
+            size_t size();
+            Grabber & get( size_t index );
+            const Device & getDevice( size_t index );
+            bool isOpen( size_t index );
+            int find( const std::string & camera ); // by id, serial number or physical id, -1 when not in the group
+
+            void update(); // every open camera's update(), call from the main thread
+
+            WorkerPool & getWorkerPool();
+            CameraGroupStats getStats();
+
+        private:
+            CameraGroupSettings settings;
+            WorkerPool workers; // before the grabbers, so their conversions stop first
+            std::vector<Device> devices;
+            std::vector<std::unique_ptr<Grabber>> grabbers;
+            std::vector<char> opened;
+    };
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace ofxAravis {
+
+    // ------- MAILBOX -------
+
+    // Wait-free triple buffer for handing the latest value from one producer thread to
+    // one consumer thread. The producer never blocks and never waits for the consumer;
+    // the consumer always sees the newest completed value, older unread values are dropped.
+
+    template<typename T>
+    class Mailbox {
+        public:
+
+            // producer: publish a value, replacing any value the consumer hasn't picked up yet
+            void write( T value ) {
+                slots[back] = std::move( value );
+                uint8_t previous = state.exchange( uint8_t( back | DIRTY ), std::memory_order_acq_rel );
+                back = previous & INDEX;
+                published.fetch_add( 1, std::memory_order_relaxed );
+                if (previous & DIRTY) dropped.fetch_add( 1, std::memory_order_relaxed ); // consumer never saw the previous value
+            }
+
+            // consumer: swap in the newest value if there is one, returns false when nothing new arrived
+            bool update() {
+                if (!(state.load( std::memory_order_relaxed ) & DIRTY)) return false;
+                uint8_t previous = state.exchange( front, std::memory_order_acq_rel );
+                front = previous & INDEX;
+                return true;
+            }
+
+            // consumer: the value taken by the last successful update(), stays valid until the next one
+            T & get() { return slots[front]; }
+
+            bool hasNew() const { return state.load( std::memory_order_relaxed ) & DIRTY; }
+
+            uint64_t getPublishedCount() const { return published.load( std::memory_order_relaxed ); }
+            uint64_t getOverwrittenCount() const { return dropped.load( std::memory_order_relaxed ); }
+
+        private:
+            static const uint8_t INDEX = 0x3;
+            static const uint8_t DIRTY = 0x4;
+
+            T slots[3];
+            uint8_t front = 0; // consumer only
+            uint8_t back = 2; // producer only
+            std::atomic<uint8_t> state { 1 }; // middle slot index + dirty bit
+            std::atomic<uint64_t> published { 0 };
+            std::atomic<uint64_t> dropped { 0 };
+    };
+
+}
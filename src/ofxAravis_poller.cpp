@@ -0,0 +1,280 @@
+#include "ofxAravis_poller.h"
+
+#include <cmath>
+
+namespace ofxAravis {
+
+	// ------- FEATURE POLLER -------
+
+	FeaturePoller::~FeaturePoller() {
+		stop();
+	}
+
+	void FeaturePoller::add( const std::string & key, double interval, Reader reader, double ttl ) {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			Entry & entry = entries[key];
+			entry.interval = std::max( interval, 0.001 );
+			entry.ttl = ttl > 0 ? ttl : entry.interval * 3;
+			entry.reader = reader;
+			entry.valid = false;
+			entry.added = true;
+			entry.due = Clock::now();
+		}
+		wake.notify_one();
+	}
+
+	void FeaturePoller::remove( const std::string & key ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		auto it = entries.find( key );
+		if (it == entries.end()) return;
+		for (auto & listener : it->second.listeners) subscriptions.erase( listener.first );
+		entries.erase( it );
+	}
+
+	void FeaturePoller::clear() {
+		std::lock_guard<std::mutex> lock( mutex );
+		entries.clear();
+		subscriptions.clear();
+	}
+
+	int FeaturePoller::subscribe( const std::string & key, double interval, Callback callback, Reader reader, double tolerance ) {
+
+		if (!callback) return -1;
+
+		int id;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+
+			auto it = entries.find( key );
+			if (it == entries.end()) {
+				if (!reader) return -1;
+				Entry & entry = entries[key];
+				entry.interval = std::max( interval, 0.001 );
+				entry.ttl = entry.interval * 3;
+				entry.reader = reader;
+				entry.due = Clock::now();
+				it = entries.find( key );
+			} else if (interval < it->second.interval) {
+				it->second.interval = std::max( interval, 0.001 );
+				it->second.ttl = std::max( it->second.ttl, it->second.interval * 3 );
+				it->second.due = std::min( it->second.due, Clock::now() + std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( it->second.interval ) ) );
+			}
+
+			id = nextId++;
+			Listener & listener = it->second.listeners[id];
+			listener.callback = callback;
+			listener.tolerance = tolerance;
+			subscriptions[id] = key;
+		}
+		wake.notify_one();
+		return id;
+	}
+
+	void FeaturePoller::unsubscribe( int id ) {
+		std::unique_lock<std::mutex> lock( mutex );
+		auto sub = subscriptions.find( id );
+		if (sub == subscriptions.end()) return;
+		auto it = entries.find( sub->second );
+		subscriptions.erase( sub );
+		if (it != entries.end()) {
+			it->second.listeners.erase( id );
+			if (!it->second.added && it->second.listeners.empty()) entries.erase( it );
+		}
+
+		// queued notifications check the subscription first, only the running one is waited for
+		if (std::this_thread::get_id() == thread.get_id()) return;
+		called.wait( lock, [this, id] { return calling != id; } );
+	}
+
+	void FeaturePoller::setCycleMutex( std::recursive_mutex * m ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		cycleMutex = m;
+	}
+
+	void FeaturePoller::start() {
+		std::lock_guard<std::mutex> lock( mutex );
+		if (running) return;
+		running = true;
+		thread = std::thread( &FeaturePoller::threadedFunction, this );
+	}
+
+	void FeaturePoller::stop() {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (!running) return;
+			running = false;
+		}
+		wake.notify_all();
+		thread.join();
+
+		std::lock_guard<std::mutex> lock( mutex );
+		for (auto & it : entries) it.second.valid = false;
+	}
+
+	bool FeaturePoller::isRunning() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return running;
+	}
+
+	void FeaturePoller::refresh( const std::string & key ) {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			auto it = entries.find( key );
+			if (it == entries.end()) return;
+			it->second.due = Clock::now();
+			if (it->second.reading) it->second.stale = true;
+		}
+		wake.notify_one();
+	}
+
+	bool FeaturePoller::get( const std::string & key, ofJson & value ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		auto it = entries.find( key );
+		if (it == entries.end() || !it->second.valid) return false;
+		if (Clock::now() - it->second.updated > std::chrono::duration<double>( it->second.ttl )) return false;
+		value = it->second.value;
+		return true;
+	}
+
+	ofJson FeaturePoller::get( const std::string & key, const ofJson & fallback ) {
+		ofJson value;
+		return get( key, value ) ? value : fallback;
+	}
+
+	ofJson FeaturePoller::getAll() {
+		std::lock_guard<std::mutex> lock( mutex );
+		ofJson all = ofJson::object();
+		auto now = Clock::now();
+		for (auto & it : entries) {
+			const Entry & entry = it.second;
+			if (entry.valid && now - entry.updated <= std::chrono::duration<double>( entry.ttl )) all[it.first] = entry.value;
+		}
+		return all;
+	}
+
+	uint64_t FeaturePoller::getReadCount() {
+		return reads;
+	}
+
+	uint64_t FeaturePoller::getFailedCount() {
+		return failed;
+	}
+
+	uint64_t FeaturePoller::getCycleCount() {
+		return cycles;
+	}
+
+	uint64_t FeaturePoller::getNotifyCount() {
+		return notified;
+	}
+
+	namespace {
+
+		bool differs( const ofJson & a, const ofJson & b, double tolerance ) {
+			if (a.is_number() && b.is_number()) return std::abs( a.get<double>() - b.get<double>() ) > tolerance;
+			return a != b;
+		}
+
+	}
+
+	void FeaturePoller::threadedFunction() {
+
+		struct Read {
+			std::string key;
+			Reader reader;
+			ofJson value;
+		};
+
+		struct Notification {
+			int id;
+			Callback callback;
+			std::string key;
+			ofJson value;
+			ofJson previous;
+		};
+
+		std::vector<Read> batch;
+		std::vector<Notification> notifications;
+
+		std::unique_lock<std::mutex> lock( mutex );
+
+		while (running) {
+
+			// every entry that is due goes into this cycle, readers run without the lock so getters never wait on the device
+
+			auto now = Clock::now();
+			auto next = now + std::chrono::seconds( 1 );
+			batch.clear();
+
+			for (auto & it : entries) {
+				Entry & entry = it.second;
+				if (entry.reading) continue;
+				if (entry.due <= now) {
+					batch.push_back( { it.first, entry.reader, nullptr } );
+					entry.reading = true;
+				} else if (entry.due < next) {
+					next = entry.due;
+				}
+			}
+
+			if (batch.empty()) {
+				wake.wait_until( lock, next );
+				continue;
+			}
+
+			std::recursive_mutex * cycle = cycleMutex;
+			lock.unlock();
+			{
+				std::unique_lock<std::recursive_mutex> control;
+				if (cycle) control = std::unique_lock<std::recursive_mutex>( *cycle );
+				for (auto & read : batch) read.value = read.reader();
+			}
+			lock.lock();
+
+			cycles += 1;
+			notifications.clear();
+
+			for (auto & read : batch) {
+
+				reads += 1;
+				if (read.value.is_null()) failed += 1;
+
+				auto it = entries.find( read.key );
+				if (it == entries.end()) continue; // removed while reading
+
+				Entry & entry = it->second;
+				entry.reading = false;
+				entry.due = Clock::now() + std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( entry.interval ) );
+				if (entry.stale) entry.due = Clock::now();
+				entry.stale = false;
+				if (read.value.is_null()) continue;
+
+				entry.value = read.value;
+				entry.updated = Clock::now();
+				entry.valid = true;
+
+				for (auto & it : entry.listeners) {
+					Listener & listener = it.second;
+					if (!listener.last.is_null() && !differs( listener.last, read.value, listener.tolerance )) continue;
+					notifications.push_back( { it.first, listener.callback, read.key, read.value, listener.last } );
+					listener.last = read.value;
+				}
+			}
+
+			// callbacks may subscribe, unsubscribe or refresh, so they run without the lock
+
+			for (auto & n : notifications) {
+				if (!subscriptions.count( n.id )) continue; // unsubscribed since, maybe by an earlier callback
+				calling = n.id;
+				lock.unlock();
+				n.callback( n.key, n.value, n.previous );
+				lock.lock();
+				calling = -1;
+				notified += 1;
+				called.notify_all();
+			}
+		}
+	}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace ofxAravis {
+
+    // ------- FEATURE POLLER -------
+
+    // Keeps a cache of camera state fresh from a background thread, so render code can read it
+    // without blocking on control transactions. Each entry has its own refresh interval and a TTL
+    // after which a value that could not be refreshed is no longer served.
+    //
+    // Every entry that is due is read in the same cycle, under the cycle mutex when one is set,
+    // so one camera costs one burst of control traffic per cycle instead of one per value.
+
+    class FeaturePoller {
+        public:
+            using Reader = std::function<ofJson()>; // runs on the poller thread, null json = read failed
+            // runs on the poller thread when a value changes, previous is null on the first read
+            using Callback = std::function<void( const std::string & key, const ofJson & value, const ofJson & previous )>;
+
+            ~FeaturePoller();
+
+            // ttl <= 0 means three intervals
+            void add( const std::string & key, double interval, Reader reader, double ttl = 0 );
+            void remove( const std::string & key );
+            void clear();
+
+            // calls back when the value at key differs from the last one this subscriber saw, numbers
+            // within tolerance count as equal. An existing entry keeps its reader and polls at the
+            // faster of the two intervals; reader may be empty then. Returns an id, -1 on failure.
+            int subscribe( const std::string & key, double interval, Callback callback, Reader reader = Reader(), double tolerance = 0 );
+            // no call for id starts after this returns, and one already running is waited for, so the
+            // callback's captures can go right after. Inside a callback it doesn't wait; don't call it
+            // holding a lock that callback takes
+            void unsubscribe( int id );
+
+            void setCycleMutex( std::recursive_mutex * mutex ); // held while a cycle's readers run, from the next cycle on
+            void start();
+            void stop();
+            bool isRunning();
+
+            void refresh( const std::string & key ); // read again as soon as possible, e.g. after a write
+
+            bool get( const std::string & key, ofJson & value ); // false when missing or expired
+            ofJson get( const std::string & key, const ofJson & fallback );
+            ofJson getAll(); // every fresh value, keyed by name
+
+            uint64_t getReadCount();
+            uint64_t getFailedCount();
+            uint64_t getCycleCount();
+            uint64_t getNotifyCount();
+
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            struct Listener {
+                Callback callback;
+                double tolerance = 0;
+                ofJson last; // value this listener was last called with
+            };
+
+            struct Entry {
+                double interval = 1;
+                double ttl = 3;
+                Reader reader;
+                ofJson value;
+                Clock::time_point updated;
+                Clock::time_point due;
+                bool valid = false;
+                bool reading = false;
+                bool stale = false; // refreshed while reading, the value in flight may predate a write
+                bool added = false; // through add(), otherwise the entry goes with its last subscriber
+                std::map<int, Listener> listeners;
+            };
+
+            void threadedFunction();
+
+            std::map<std::string, Entry> entries;
+            std::map<int, std::string> subscriptions; // id -> key
+            int nextId = 0;
+            std::recursive_mutex * cycleMutex = nullptr;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable called; // a callback returned
+            int calling = -1; // subscription whose callback runs now
+            std::thread thread;
+            bool running = false;
+            std::atomic<uint64_t> reads { 0 };
+            std::atomic<uint64_t> failed { 0 };
+            std::atomic<uint64_t> cycles { 0 };
+            std::atomic<uint64_t> notified { 0 };
+    };
+
+}
@@ -0,0 +1,197 @@
+#include "ofxAravis_profile.h"
+
+#include <fstream>
+#include <map>
+#include <set>
+
+namespace ofxAravis {
+
+	namespace {
+
+		// state of the device rather than configuration
+		const char * SKIPPED[] = { "TLParamsLocked", "DeviceReset", "UserSetLoad", "UserSetSave" };
+
+		bool isSkipped( const std::string & name ) {
+			for (auto skipped : SKIPPED) if (name == skipped) return true;
+			return false;
+		}
+
+		struct Collected {
+			ofJson values = ofJson::object();
+			std::map<std::string, std::vector<std::string>> dependsOn;
+			std::map<std::string, std::vector<std::string>> selects;
+		};
+
+		void collect( const ofJson & entry, Collected & collected ) {
+
+			if (!entry.is_object()) return;
+
+			std::string name = entry.value( "featureName", "" );
+			std::string access = entry.value( "accessMode", "" );
+			bool writable = access == "RW";
+
+			if (writable && !name.empty() && entry.count( "value" ) && !entry["value"].is_null() && !isSkipped( name )) {
+				collected.values[name] = entry["value"];
+			}
+			if (entry.count( "dependsOn" ) && entry["dependsOn"].is_array()) collected.dependsOn[name] = entry["dependsOn"].get<std::vector<std::string>>();
+			if (entry.count( "options" ) && entry["options"].is_array()) collected.selects[name] = entry["options"].get<std::vector<std::string>>();
+
+			if (entry.count( "children" ) && entry["children"].is_array()) {
+				for (auto & child : entry["children"]) collect( child, collected );
+			}
+		}
+
+		bool isAutoOn( const ofJson & values, const std::string & name ) {
+			if (name.size() <= 4 || name.compare( name.size() - 4, 4, "Auto" ) != 0 || !values.count( name )) return false;
+			const ofJson & value = values[name];
+			return !(value.is_string() && value.get<std::string>() == "Off") && !(value.is_boolean() && !value.get<bool>());
+		}
+
+		// ExposureTime under ExposureAuto=Continuous is whatever the camera last settled on,
+		// writing it back would fail (read only) or fight the auto mode
+		bool isDriven( const Collected & collected, const std::string & name ) {
+			auto it = collected.dependsOn.find( name );
+			if (it == collected.dependsOn.end()) return false;
+			for (auto & dependency : it->second) if (isAutoOn( collected.values, dependency )) return true;
+			return false;
+		}
+
+	}
+
+	// ------- PROFILES -------
+
+	ofJson ProfileToValues( const ofJson & profile ) {
+
+		Collected collected;
+
+		if (profile.is_array()) {
+			for (auto & entry : profile) {
+				ofJson flat = entry;
+				flat.erase( "children" ); // indices in the flat form
+				collect( flat, collected );
+			}
+		} else {
+			collect( profile, collected );
+		}
+
+		ofJson values = ofJson::object();
+		for (auto it = collected.values.begin(); it != collected.values.end(); ++it) {
+			if (!isDriven( collected, it.key() )) values[it.key()] = it.value();
+		}
+
+		bool hasSelected = profile.is_object() && profile.count( "selected" ) && profile["selected"].is_array() && !profile["selected"].empty();
+		if (!hasSelected) return values;
+
+		// every selector in "selected" and what it selects are written per entry instead
+
+		std::set<std::string> selectors, covered;
+		for (auto & item : profile["selected"]) {
+			if (!item.is_object() || item.empty()) continue;
+			std::string name = item.begin().key();
+			if (!collected.selects.count( name )) continue;
+			selectors.insert( name );
+			covered.insert( name );
+			for (auto & selected : collected.selects[name]) covered.insert( selected );
+		}
+
+		// in array form each selector starts a segment, the remaining ones go first so the
+		// plain values share the last of those segments as they would in object form
+		ofJson ordered = ofJson::array();
+		for (auto it = values.begin(); it != values.end(); ++it) {
+			if (!covered.count( it.key() ) && collected.selects.count( it.key() )) ordered.push_back( { { it.key(), it.value() } } );
+		}
+		for (auto it = values.begin(); it != values.end(); ++it) {
+			if (!covered.count( it.key() ) && !collected.selects.count( it.key() )) ordered.push_back( { { it.key(), it.value() } } );
+		}
+		for (auto & item : profile["selected"]) {
+			if (!item.is_object() || item.empty()) continue;
+			std::string name = item.begin().key();
+			if (isSkipped( name ) || isDriven( collected, name )) continue;
+			ordered.push_back( item );
+		}
+		for (auto & name : selectors) {
+			if (values.count( name )) ordered.push_back( { { name, values[name] } } );
+		}
+		return ordered;
+	}
+
+	ofJson ReadSelectorValues( FeatureCache & cache, const FeatureTree & tree ) {
+
+		ofJson selected = ofJson::array();
+		std::set<std::string> done;
+
+		std::lock_guard<std::recursive_mutex> control( cache.getControlMutex() );
+
+		for (auto & entry : tree.getEntries()) {
+
+			if (!entry.isSelector || entry.type != FEATURE_ENUMERATION || entry.selected.empty()) continue;
+			if (!done.insert( entry.name ).second) continue;
+
+			FeatureHandlePtr selector = cache.resolve( entry.name );
+			if (!selector || !selector->isWritable()) continue;
+
+			GError * err = nullptr;
+			ofJson original = cache.getValue( entry.name, &err );
+			if (err || original.is_null()) {
+				g_clear_error( &err );
+				continue;
+			}
+
+			for (auto & option : entry.enumEntries) {
+
+				if (!arv_gc_feature_node_is_available( ARV_GC_FEATURE_NODE( option.node ), nullptr )) continue;
+				if (!cache.setString( entry.name, option.name, &err )) {
+					g_clear_error( &err );
+					continue;
+				}
+				selected.push_back( { { entry.name, option.name } } );
+
+				for (auto & name : entry.selected) {
+					FeatureHandlePtr handle = cache.resolve( name );
+					if (!handle || handle->type == FEATURE_COMMAND || isSkipped( name )) continue;
+					// access can change with the selector, e.g. a LineMode that is fixed for an output line
+					ArvGcAccessMode access = arv_gc_feature_node_get_actual_access_mode( ARV_GC_FEATURE_NODE( handle->node ) );
+					if (access != ARV_GC_ACCESS_MODE_RW) continue;
+					ofJson value = cache.getValue( name, &err );
+					if (err) {
+						g_clear_error( &err );
+						continue;
+					}
+					if (!value.is_null()) selected.push_back( { { name, value } } );
+				}
+			}
+
+			cache.setString( entry.name, original.get<std::string>(), &err );
+			g_clear_error( &err );
+		}
+
+		return selected;
+	}
+
+	bool SaveProfile( const std::string & path, const ofJson & profile ) {
+		std::ofstream file( ofToDataPath( path, true ) );
+		file << profile.dump( 4 );
+		return bool( file );
+	}
+
+	ofJson LoadProfile( const std::string & path ) {
+		std::ifstream file( ofToDataPath( path, true ) );
+		if (!file) {
+			ofLogError("ofxAravis") << "LoadProfile: can't open " << path;
+			return nullptr;
+		}
+		try {
+			ofJson profile;
+			file >> profile;
+			return profile;
+		} catch (std::exception & e) {
+			ofLogError("ofxAravis") << "LoadProfile: " << path << ": " << e.what();
+			return nullptr;
+		}
+	}
+
+	ApplyResult ApplyProfile( FeatureCache & cache, const ofJson & profile, const ApplyOptions & options ) {
+		return ApplyFeatures( cache, ProfileToValues( profile ), options );
+	}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ofxAravis_apply.h"
+#include "ofxAravis_tree.h"
+
+namespace ofxAravis {
+
+    // ------- PROFILES -------
+
+    // A profile is a feature dump as listAllFeatures() returns it (DAHENG_MEP2.json is one), or
+    // the flat FeatureTree::toJson() array. Loading one keeps only what can be written back:
+    // readable and writable features with a value, minus anything locked by an auto mode the
+    // profile leaves on (the "dependsOn" links of the dump). ApplyFeatures then skips what already
+    // matches and orders the rest. Dumps without the links, like the older ones, rely on that
+    // order alone: auto modes are switched on after the values they would override.
+    //
+    // A dump only holds what each selector selects at its current value: one BalanceRatio, not
+    // Red, Green and Blue. saveProfile adds a "selected" array to the root with every entry of
+    // every enumeration selector, see ReadSelectorValues; dumps without it restore just the one.
+
+    // { "Width": 1024, "ExposureAuto": "Off", ... } from a profile, or ApplyFeatures' array form
+    // when it carries "selected", with the selectors back at their saved entries at the end
+    ofJson ProfileToValues( const ofJson & profile );
+
+    // [ { "BalanceRatioSelector": "Red" }, { "BalanceRatio": 1.4 }, { "BalanceRatioSelector": "Blue" }, ... ]
+    // for every available entry of every writable enumeration selector in tree, by switching to each
+    // one in turn under the control lock; each selector is put back where it was. Integer
+    // selectors (LUTIndex and such) are left out, they can run into thousands of values.
+    ofJson ReadSelectorValues( FeatureCache & cache, const FeatureTree & tree );
+
+    bool SaveProfile( const std::string & path, const ofJson & profile ); // paths relative to bin/data
+    ofJson LoadProfile( const std::string & path ); // null json when missing or unreadable
+
+    ApplyResult ApplyProfile( FeatureCache & cache, const ofJson & profile, const ApplyOptions & options = ApplyOptions() );
+
+}
@@ -0,0 +1,127 @@
+#include "ofxAravis_queue.h"
+
+namespace ofxAravis {
+
+	// ------- FRAME QUEUE -------
+
+	FrameQueue::~FrameQueue() {
+		stop();
+	}
+
+	void FrameQueue::start( const QueueSettings & s, Handler h ) {
+
+		stop();
+
+		std::lock_guard<std::mutex> lock( mutex );
+		settings = s;
+		if (settings.capacity < 1) settings.capacity = 1;
+		handler = h;
+		stats = QueueStats();
+		running = true;
+		thread = std::thread( &FrameQueue::threadedFunction, this );
+	}
+
+	void FrameQueue::stop() {
+
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (!running) return;
+			running = false;
+		}
+
+		notEmpty.notify_all();
+		notFull.notify_all();
+		if (thread.joinable()) thread.join();
+
+		std::lock_guard<std::mutex> lock( mutex );
+		queue.clear();
+		stats.depth = 0;
+	}
+
+	bool FrameQueue::isRunning() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return running;
+	}
+
+	bool FrameQueue::push( FrameLease lease ) {
+
+		FrameLease dropped; // released outside the lock
+		bool accepted = true;
+
+		{
+			std::unique_lock<std::mutex> lock( mutex );
+			if (!running) return false;
+
+			if (queue.size() >= settings.capacity) {
+				switch (settings.policy) {
+					case OVERFLOW_DROP_OLDEST:
+						dropped = std::move( queue.front() );
+						queue.pop_front();
+						stats.droppedOldest += 1;
+						break;
+
+					case OVERFLOW_DROP_NEWEST:
+						stats.droppedNewest += 1;
+						accepted = false;
+						break;
+
+					case OVERFLOW_BLOCK: {
+						auto timeout = std::chrono::milliseconds( settings.blockTimeoutMs );
+						bool room = notFull.wait_for( lock, timeout, [this] { return queue.size() < settings.capacity || !running; } );
+						if (!room || !running) {
+							stats.timedOut += 1;
+							accepted = false;
+						}
+					}
+						break;
+				}
+			}
+
+			if (accepted) {
+				queue.push_back( std::move( lease ) );
+				stats.enqueued += 1;
+				stats.depth = queue.size();
+				if (stats.depth > stats.maxDepth) stats.maxDepth = stats.depth;
+			}
+		}
+
+		if (accepted) notEmpty.notify_one();
+		return accepted && !dropped;
+	}
+
+	QueueStats FrameQueue::getStats() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return stats;
+	}
+
+	void FrameQueue::resetStats() {
+		std::lock_guard<std::mutex> lock( mutex );
+		size_t depth = stats.depth;
+		stats = QueueStats();
+		stats.depth = depth;
+		stats.maxDepth = depth;
+	}
+
+	void FrameQueue::threadedFunction() {
+
+		while (true) {
+
+			FrameLease lease;
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+				notEmpty.wait( lock, [this] { return !queue.empty() || !running; } );
+				if (!running) return;
+				lease = std::move( queue.front() );
+				queue.pop_front();
+				stats.depth = queue.size();
+			}
+
+			notFull.notify_one();
+			handler( std::move( lease ) );
+
+			std::lock_guard<std::mutex> lock( mutex );
+			stats.delivered += 1;
+		}
+	}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ofxAravis_frame.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+
+namespace ofxAravis {
+
+    // ------- FRAME QUEUE -------
+
+    // Optional stage between acquisition and user callbacks: acquisition only enqueues,
+    // a dispatch thread dequeues and runs the handler, so slow callbacks no longer stall the stream.
+    // Queued leases hold stream buffers, keep capacity below the number of stream buffers.
+
+    enum OverflowPolicy {
+        OVERFLOW_DROP_OLDEST, // make room by releasing the oldest queued frame
+        OVERFLOW_DROP_NEWEST, // release the incoming frame
+        OVERFLOW_BLOCK // wait up to blockTimeoutMs for room, then release the incoming frame
+    };
+
+    struct QueueSettings {
+        bool enabled = false;
+        size_t capacity = 4;
+        OverflowPolicy policy = OVERFLOW_DROP_OLDEST;
+        int blockTimeoutMs = 10;
+    };
+
+    struct QueueStats {
+        uint64_t enqueued = 0;
+        uint64_t delivered = 0;
+        uint64_t droppedOldest = 0;
+        uint64_t droppedNewest = 0;
+        uint64_t timedOut = 0; // OVERFLOW_BLOCK pushes that gave up
+        size_t depth = 0;
+        size_t maxDepth = 0;
+
+        uint64_t getDropped() const { return droppedOldest + droppedNewest + timedOut; }
+    };
+
+    class FrameQueue {
+        public:
+            using Handler = std::function<void(FrameLease)>; // takes ownership so it can release early
+
+            ~FrameQueue();
+
+            void start( const QueueSettings & settings, Handler handler );
+            void stop(); // drops whatever is still queued
+            bool isRunning();
+
+            bool push( FrameLease lease ); // false when a frame was dropped
+
+            QueueStats getStats();
+            void resetStats();
+
+        private:
+            void threadedFunction();
+
+            QueueSettings settings;
+            Handler handler;
+
+            std::deque<FrameLease> queue;
+            std::mutex mutex;
+            std::condition_variable notEmpty;
+            std::condition_variable notFull;
+            std::thread thread;
+            bool running = false;
+
+            QueueStats stats;
+    };
+
+}
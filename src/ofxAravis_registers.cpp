@@ -0,0 +1,357 @@
+#include "ofxAravis_registers.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace ofxAravis {
+
+	namespace {
+
+		void encode( uint64_t bits, guint32 length, bool bigEndian, uint8_t * bytes ) {
+			for (guint32 i = 0; i < length; i++) {
+				int shift = bigEndian ? 8 * (length - 1 - i) : 8 * i;
+				bytes[i] = uint8_t( bits >> shift );
+			}
+		}
+
+		uint64_t toBits( FeatureType type, guint32 length, double value ) {
+			if (type == FEATURE_INTEGER) return uint64_t( gint64( std::llround( value ) ) );
+			if (length == 4) {
+				float f = float( value );
+				uint32_t bits;
+				memcpy( &bits, &f, 4 );
+				return bits;
+			}
+			uint64_t bits;
+			memcpy( &bits, &value, 8 );
+			return bits;
+		}
+
+		ArvGcPropertyNode * findProperty( ArvGcNode * node, ArvGcPropertyNodeType type ) {
+			for (ArvDomNode * child = arv_dom_node_get_first_child( ARV_DOM_NODE( node ) ); child; child = arv_dom_node_get_next_sibling( child )) {
+				if (ARV_IS_GC_PROPERTY_NODE( child ) && arv_gc_property_node_get_node_type( ARV_GC_PROPERTY_NODE( child ) ) == type) return ARV_GC_PROPERTY_NODE( child );
+			}
+			return nullptr;
+		}
+
+		std::string nameOf( ArvGcNode * node ) {
+			const char * name = ARV_IS_GC_FEATURE_NODE( node ) ? arv_gc_feature_node_get_name( ARV_GC_FEATURE_NODE( node ) ) : nullptr;
+			return name ? name : "";
+		}
+
+		// a node naming one of ours as pInvalidator or pSelected changes when ours is written,
+		// which a write to memory would never tell it
+
+		std::string findDependent( ArvDomNode * parent, const std::vector<std::string> & chain ) {
+			for (ArvDomNode * child = arv_dom_node_get_first_child( parent ); child; child = arv_dom_node_get_next_sibling( child )) {
+				if (!ARV_IS_GC_PROPERTY_NODE( child )) {
+					std::string found = findDependent( child, chain );
+					if (!found.empty()) return found;
+					continue;
+				}
+				ArvGcPropertyNodeType type = arv_gc_property_node_get_node_type( ARV_GC_PROPERTY_NODE( child ) );
+				if (type != ARV_GC_PROPERTY_NODE_TYPE_P_INVALIDATOR && type != ARV_GC_PROPERTY_NODE_TYPE_P_SELECTED) continue;
+				ArvGcNode * linked = arv_gc_property_node_get_linked_node( ARV_GC_PROPERTY_NODE( child ) );
+				std::string name = linked ? nameOf( linked ) : "";
+				if (name.empty() || std::find( chain.begin(), chain.end(), name ) == chain.end()) continue;
+				std::string owner = nameOf( ARV_GC_NODE( parent ) );
+				return type == ARV_GC_PROPERTY_NODE_TYPE_P_SELECTED
+					? name + " is selected by " + owner
+					: owner + " is invalidated by " + name;
+			}
+			return "";
+		}
+
+		// the features a pIsLocked formula reads, a write to any of them can lock or unlock the feature
+
+		void collectLockers( ArvGcNode * node, std::vector<std::string> & names, int depth ) {
+			if (depth > 8) return;
+			for (ArvDomNode * child = arv_dom_node_get_first_child( ARV_DOM_NODE( node ) ); child; child = arv_dom_node_get_next_sibling( child )) {
+				if (!ARV_IS_GC_PROPERTY_NODE( child )) continue;
+				ArvGcPropertyNodeType type = arv_gc_property_node_get_node_type( ARV_GC_PROPERTY_NODE( child ) );
+				if (depth == 0 && type != ARV_GC_PROPERTY_NODE_TYPE_P_IS_LOCKED) continue;
+				if (type == ARV_GC_PROPERTY_NODE_TYPE_P_PORT) continue;
+				ArvGcNode * linked = arv_gc_property_node_get_linked_node( ARV_GC_PROPERTY_NODE( child ) );
+				if (!linked) continue;
+				std::string name = nameOf( linked );
+				if (!name.empty() && std::find( names.begin(), names.end(), name ) == names.end()) names.push_back( name );
+				collectLockers( linked, names, depth + 1 );
+			}
+		}
+
+		// written as is: not locked (TLParamsLocked, an auto that is on) and writable right now
+
+		bool writableNow( ArvGcNode * node, std::string & reason ) {
+			GError * err = nullptr;
+			bool locked = arv_gc_feature_node_is_locked( ARV_GC_FEATURE_NODE( node ), &err );
+			ArvGcAccessMode mode = arv_gc_feature_node_get_actual_access_mode( ARV_GC_FEATURE_NODE( node ) );
+			if (err) {
+				reason = err->message;
+				g_clear_error( &err );
+				return false;
+			}
+			if (locked) reason = "locked";
+			else if (mode != ARV_GC_ACCESS_MODE_RW && mode != ARV_GC_ACCESS_MODE_WO) reason = std::string( "access mode " ) + arv_gc_access_mode_to_string( mode );
+			else return true;
+			return false;
+		}
+
+	}
+
+	// ------- REGISTER FAST PATH -------
+
+	void RegisterFastPath::setCamera( ArvCamera * c, FeatureCache * f ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		camera = c;
+		features = f;
+		mappings.clear();
+	}
+
+	bool RegisterFastPath::enable( const std::string & feature ) {
+
+		RegisterMapping mapping;
+		mapping.feature = feature;
+
+		FeatureCache * cache;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			cache = features;
+		}
+
+		// owners swap the camera under the control lock, so it is only looked at under it
+		if (cache) {
+			std::lock_guard<std::recursive_mutex> control( cache->getControlMutex() );
+			if (camera) map( mapping );
+			else mapping.reason = "no camera";
+		} else {
+			mapping.reason = "no camera";
+		}
+
+		if (!mapping.fast) ofLogNotice("ofxAravis") << "RegisterFastPath: " << feature << " stays on the node path, " << mapping.reason;
+		else if (!mapping.writable) ofLogNotice("ofxAravis") << "RegisterFastPath: " << feature << " is mapped but " << mapping.reason << ", writes use the node path until it can be written";
+
+		std::lock_guard<std::mutex> lock( mutex );
+		mappings[feature] = mapping;
+		return mapping.fast;
+	}
+
+	bool RegisterFastPath::map( RegisterMapping & mapping ) {
+
+		mapping.fast = false;
+
+		ArvDevice * device = arv_camera_get_device( camera );
+		ArvGc * genicam = device ? arv_device_get_genicam( device ) : nullptr;
+		ArvGcNode * node = genicam ? arv_gc_get_node( genicam, mapping.feature.c_str() ) : nullptr;
+
+		if (!node || !ARV_IS_GC_FEATURE_NODE( node )) {
+			mapping.reason = "no node " + mapping.feature;
+			return false;
+		}
+
+		// follow pValue down to the register, through plain Integer and Float nodes only
+
+		std::vector<std::string> chain;
+		ArvGcNode * reg = node;
+
+		for (int depth = 0; !ARV_IS_GC_REGISTER( reg ); depth++) {
+			std::string name = nameOf( reg );
+			chain.push_back( name );
+			if (depth >= 8) {
+				mapping.reason = "no register within 8 nodes of " + mapping.feature;
+				return false;
+			}
+			if (!ARV_IS_GC_INTEGER_NODE( reg ) && !ARV_IS_GC_FLOAT_NODE( reg )) {
+				const char * nodeType = arv_dom_node_get_node_name( ARV_DOM_NODE( reg ) );
+				mapping.reason = name + " is " + (nodeType ? nodeType : "unknown") + ", not a plain Integer or Float";
+				return false;
+			}
+			if (findProperty( reg, ARV_GC_PROPERTY_NODE_TYPE_P_INDEX ) || findProperty( reg, ARV_GC_PROPERTY_NODE_TYPE_P_VALUE_INDEXED )) {
+				mapping.reason = name + " is indexed by a selector";
+				return false;
+			}
+			ArvGcPropertyNode * value = findProperty( reg, ARV_GC_PROPERTY_NODE_TYPE_P_VALUE );
+			ArvGcNode * linked = value ? arv_gc_property_node_get_linked_node( value ) : nullptr;
+			if (!linked) {
+				mapping.reason = name + " has no pValue";
+				return false;
+			}
+			reg = linked;
+		}
+
+		mapping.registerNode = nameOf( reg );
+		chain.push_back( mapping.registerNode );
+
+		if (ARV_IS_GC_MASKED_INT_REG_NODE( reg )) {
+			mapping.reason = mapping.registerNode + " is masked";
+			return false;
+		}
+		if (ARV_IS_GC_INT_REG_NODE( reg )) mapping.type = FEATURE_INTEGER;
+		else if (ARV_IS_GC_FLOAT_REG_NODE( reg )) mapping.type = FEATURE_FLOAT;
+		else {
+			mapping.reason = mapping.registerNode + " is not an IntReg or FloatReg";
+			return false;
+		}
+		if (findProperty( reg, ARV_GC_PROPERTY_NODE_TYPE_P_INDEX )) {
+			mapping.reason = mapping.registerNode + " is indexed by a selector";
+			return false;
+		}
+
+		GError * err = nullptr;
+		mapping.address = arv_gc_register_get_address( ARV_GC_REGISTER( reg ), &err );
+		mapping.length = guint32( arv_gc_register_get_length( ARV_GC_REGISTER( reg ), &err ) );
+		if (err) {
+			mapping.reason = err->message;
+			g_clear_error( &err );
+			return false;
+		}
+		if (mapping.length != 4 && mapping.length != 8) {
+			mapping.reason = mapping.registerNode + " is " + ofToString( mapping.length ) + " bytes";
+			return false;
+		}
+
+		// GenICam registers are little endian unless they say otherwise
+		ArvGcPropertyNode * endianness = findProperty( reg, ARV_GC_PROPERTY_NODE_TYPE_ENDIANNESS );
+		mapping.bigEndian = endianness && arv_gc_property_node_get_endianness( endianness, G_LITTLE_ENDIAN ) == G_BIG_ENDIAN;
+
+		std::string dependent = findDependent( ARV_DOM_NODE( genicam ), chain );
+		if (!dependent.empty()) {
+			mapping.reason = dependent;
+			return false;
+		}
+
+		mapping.lockers.clear();
+		collectLockers( node, mapping.lockers, 0 );
+
+		mapping.fast = true;
+		mapping.reason = "";
+		mapping.writable = writableNow( node, mapping.reason );
+		mapping.stale = false;
+		return true;
+	}
+
+	void RegisterFastPath::invalidate() {
+		markStale( [] ( const RegisterMapping & ) { return true; } );
+	}
+
+	void RegisterFastPath::invalidate( const std::string & written ) {
+		markStale( [&written] ( const RegisterMapping & mapping ) {
+			return std::find( mapping.lockers.begin(), mapping.lockers.end(), written ) != mapping.lockers.end();
+		});
+	}
+
+	void RegisterFastPath::markStale( const std::function<bool( const RegisterMapping & )> & affected ) {
+
+		FeatureCache * cache;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			cache = features;
+		}
+
+		// under the control lock, so a write re-checking the lock state finishes before this lands
+
+		std::unique_lock<std::recursive_mutex> control;
+		if (cache) control = std::unique_lock<std::recursive_mutex>( cache->getControlMutex() );
+
+		std::lock_guard<std::mutex> lock( mutex );
+		for (auto & it : mappings) {
+			if (affected( it.second )) it.second.stale = true;
+		}
+	}
+
+	void RegisterFastPath::disable( const std::string & feature ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		mappings.erase( feature );
+	}
+
+	void RegisterFastPath::clear() {
+		std::lock_guard<std::mutex> lock( mutex );
+		mappings.clear();
+	}
+
+	bool RegisterFastPath::isFast( const std::string & feature ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		auto it = mappings.find( feature );
+		return it != mappings.end() && it->second.fast;
+	}
+
+	RegisterMapping RegisterFastPath::getMapping( const std::string & feature ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		auto it = mappings.find( feature );
+		return it == mappings.end() ? RegisterMapping() : it->second;
+	}
+
+	std::vector<std::string> RegisterFastPath::getFeatures() {
+		std::lock_guard<std::mutex> lock( mutex );
+		std::vector<std::string> names;
+		for (auto & it : mappings) names.push_back( it.first );
+		return names;
+	}
+
+	bool RegisterFastPath::set( const std::string & feature, double value, GError ** err ) {
+
+		FeatureCache * cache;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			cache = features;
+		}
+		if (!cache) return false;
+
+		// invalidate() takes the control lock too, so the lock state re-checked below can't be
+		// invalidated again before the write goes out
+
+		std::lock_guard<std::recursive_mutex> control( cache->getControlMutex() );
+
+		bool fast = false;
+		bool stale = false;
+		bool writable = false;
+		FeatureType type = FEATURE_UNKNOWN;
+		guint64 address = 0;
+		guint32 length = 0;
+		bool bigEndian = false;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			auto it = mappings.find( feature );
+			if (it != mappings.end()) {
+				fast = it->second.fast;
+				stale = it->second.stale;
+				writable = it->second.writable;
+				type = it->second.type;
+				address = it->second.address;
+				length = it->second.length;
+				bigEndian = it->second.bigEndian;
+			}
+		}
+
+		FeatureHandlePtr handle = fast && camera ? cache->bounded( feature ) : nullptr;
+		if (!handle) return cache->set<double>( feature, value, err );
+
+		// the lock and access state is cached, only re-read once something could have changed it
+
+		if (stale) {
+			std::string reason;
+			writable = writableNow( handle->node, reason );
+			std::lock_guard<std::mutex> lock( mutex );
+			auto it = mappings.find( feature );
+			if (it != mappings.end() && it->second.address == address) {
+				it->second.writable = writable;
+				it->second.stale = false;
+				it->second.reason = reason;
+			}
+		}
+
+		// locked or read only: the node path writes it or says why it can't
+		if (!writable) return cache->set<double>( feature, value, err );
+
+		// bounds as cached by FeatureCache, no device traffic
+		if (handle->hasBounds) value = std::min( std::max( value, handle->min ), handle->max );
+
+		uint8_t bytes[8];
+		encode( toBits( type, length, value ), length, bigEndian, bytes );
+
+		arv_device_write_memory( arv_camera_get_device( camera ), address, length, bytes, err );
+		cache->invalidateBounds( feature );
+		return !(err && *err);
+	}
+
+}
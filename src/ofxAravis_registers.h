@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ofxAravis_features.h"
+
+#include <functional>
+
+namespace ofxAravis {
+
+    // ------- REGISTER FAST PATH -------
+
+    // Opt-in direct register writes for features driven every frame (ExposureTime, Gain,
+    // tracking offsets). A feature is mapped once to the address, size and byte order of the
+    // IntReg / FloatReg behind it; later writes go straight to arv_device_write_memory without
+    // evaluating the node graph.
+    //
+    // The register is found by following pValue from the feature through plain Integer / Float
+    // nodes, byte order comes from its Endianess. A mapping is only kept when the register is
+    // provably the same thing as the feature: no mask, converter or selector index on the way,
+    // and no node naming any of them as pInvalidator or pSelected. Anything else stays on the
+    // FeatureCache path, and getMapping() says why.
+    //
+    // Whether the feature is locked (pIsLocked: TLParamsLocked, an auto that is on) or not writable
+    // is read once at enable() and cached; while it is, writes go through FeatureCache. Owners call
+    // invalidate() where that state can change: after ApplyFeatures, on stream start and stop, and
+    // invalidate( key ) after writing a feature the lock depends on. The next write re-reads it.
+    // Written values are clamped to the feature's cached bounds.
+
+    struct RegisterMapping {
+        std::string feature;
+        std::string registerNode; // IntReg / FloatReg node the feature was mapped to
+        FeatureType type = FEATURE_UNKNOWN; // of the register: integer or float
+        guint64 address = 0;
+        guint32 length = 0; // bytes: 4 or 8
+        bool bigEndian = false;
+        bool fast = false; // false = writes use the node path
+        bool writable = false; // not locked and writable, as last read; false = writes use the node path
+        bool stale = false; // writable is re-read on the next write
+        std::vector<std::string> lockers; // features behind pIsLocked
+        std::string reason; // why fast or writable is false
+    };
+
+    class RegisterFastPath {
+        public:
+            void setCamera( ArvCamera * camera, FeatureCache * features ); // drops every mapping, call under the control lock
+
+            bool enable( const std::string & feature );
+            void disable( const std::string & feature );
+            void clear();
+
+            bool isFast( const std::string & feature );
+            RegisterMapping getMapping( const std::string & feature );
+            std::vector<std::string> getFeatures(); // every feature enable() was called for, to map again after a reopen
+
+            // re-read the lock and access state on the next write: of every mapping, or of the
+            // ones whose lock depends on the written feature
+            void invalidate();
+            void invalidate( const std::string & written );
+
+            // fast when mapped and writable, FeatureCache::set otherwise
+            bool set( const std::string & feature, double value, GError ** err );
+
+        private:
+            bool map( RegisterMapping & mapping );
+            void markStale( const std::function<bool( const RegisterMapping & )> & affected );
+
+            ArvCamera * camera = nullptr;
+            FeatureCache * features = nullptr;
+            std::mutex mutex;
+            std::unordered_map<std::string, RegisterMapping> mappings;
+    };
+
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// x86 kernels are compiled per function with target attributes and picked at runtime,
+// so the addon builds with default compiler flags and still runs on CPUs without AVX2.
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OFXARAVIS_X86 1
+#include <immintrin.h>
+#define OFXARAVIS_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define OFXARAVIS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
@@ -0,0 +1,214 @@
+#include "ofxAravis_stats.h"
+
+namespace ofxAravis {
+
+	// ------- STATS -------
+
+	StatsCollector::StatsCollector() {
+		reset();
+	}
+
+	void StatsCollector::setWindow( double seconds ) {
+		if (seconds < 0.01) seconds = 0.01;
+		windowNs = uint64_t( seconds * 1e9 );
+	}
+
+	void StatsCollector::reset() {
+		uint64_t now = Now();
+		epochs[0].clear( now );
+		epochs[1].clear( now );
+		current = 0;
+		lastArrival = 0;
+		frames = 0;
+		for (auto & count : statuses) count = 0;
+	}
+
+	uint64_t StatsCollector::Now() {
+		return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+	}
+
+	void StatsCollector::Epoch::clear( uint64_t now ) {
+		for (int m = 0; m < METRIC_COUNT; m++) {
+			max[m].store( 0, std::memory_order_relaxed );
+			for (auto & bucket : buckets[m]) bucket.store( 0, std::memory_order_relaxed );
+		}
+		intervalSum.store( 0, std::memory_order_relaxed );
+		start.store( now, std::memory_order_relaxed );
+	}
+
+	// octave of the value, then 3 bits below the leading one
+
+	int StatsCollector::bucketIndex( uint64_t ns ) {
+		if (ns < SUB_BUCKETS) return int( ns );
+		int octave = 63 - __builtin_clzll( ns );
+		int sub = int( (ns >> (octave - 3)) & (SUB_BUCKETS - 1) );
+		return (octave - 2) * SUB_BUCKETS + sub;
+	}
+
+	uint64_t StatsCollector::bucketUpper( int index ) {
+		if (index < SUB_BUCKETS) return uint64_t( index );
+		int octave = index / SUB_BUCKETS + 2;
+		int sub = index % SUB_BUCKETS;
+		return ((uint64_t( SUB_BUCKETS + sub ) + 1) << (octave - 3)) - 1;
+	}
+
+	// whoever notices the window is over flips epochs, a sample landing in an epoch
+	// while it is being cleared may be lost, which is fine for statistics
+
+	void StatsCollector::rotate( uint64_t now ) {
+
+		Epoch & active = epochs[current.load( std::memory_order_relaxed )];
+		uint64_t start = active.start.load( std::memory_order_relaxed );
+		uint64_t window = windowNs.load( std::memory_order_relaxed );
+		if (now < start + window) return;
+		if (rotating.exchange( true, std::memory_order_acquire )) return;
+
+		int next = 1 - current.load( std::memory_order_relaxed );
+		epochs[next].clear( now );
+		current.store( next, std::memory_order_release );
+
+		// nothing arrived for a whole window, the old epoch is stale too
+		if (now >= start + 2 * window) epochs[1 - next].clear( now );
+
+		rotating.store( false, std::memory_order_release );
+	}
+
+	void StatsCollector::frameArrived( uint64_t now ) {
+
+		rotate( now );
+		frames.fetch_add( 1, std::memory_order_relaxed );
+		Epoch & epoch = epochs[current.load( std::memory_order_relaxed )];
+
+		uint64_t last = lastArrival.exchange( now, std::memory_order_relaxed );
+		if (last > 0 && now > last) {
+			epoch.intervalSum.fetch_add( now - last, std::memory_order_relaxed );
+			record( METRIC_INTERVAL, now - last );
+		}
+	}
+
+	void StatsCollector::record( StatsMetric metric, uint64_t ns ) {
+
+		Epoch & epoch = epochs[current.load( std::memory_order_relaxed )];
+		epoch.buckets[metric][bucketIndex( ns )].fetch_add( 1, std::memory_order_relaxed );
+
+		uint64_t max = epoch.max[metric].load( std::memory_order_relaxed );
+		while (ns > max && !epoch.max[metric].compare_exchange_weak( max, ns, std::memory_order_relaxed )) {}
+	}
+
+	void StatsCollector::bufferStatus( ArvBufferStatus status ) {
+		int index = int( status ) + 1;
+		if (index < 0 || index >= 10) index = 0;
+		statuses[index].fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	StatsSnapshot StatsCollector::getSnapshot() {
+
+		uint64_t now = Now();
+		rotate( now );
+
+		StatsSnapshot snapshot;
+
+		int active = current.load( std::memory_order_acquire );
+		const Epoch & newer = epochs[active];
+		const Epoch & older = epochs[1 - active];
+
+		uint64_t start = std::min( older.start.load( std::memory_order_relaxed ), newer.start.load( std::memory_order_relaxed ) );
+		snapshot.window = now > start ? double( now - start ) / 1e9 : 0;
+		snapshot.frames = frames.load( std::memory_order_relaxed );
+
+		for (int i = 0; i < 10; i++) snapshot.bufferStatus[i] = statuses[i].load( std::memory_order_relaxed );
+
+		// intervals over their own duration, stretched to the window once frames stop arriving
+
+		uint64_t intervals = 0;
+		for (int i = 0; i < BUCKETS; i++) intervals += older.buckets[METRIC_INTERVAL][i].load( std::memory_order_relaxed ) + newer.buckets[METRIC_INTERVAL][i].load( std::memory_order_relaxed );
+		double duration = std::max( double( older.intervalSum.load( std::memory_order_relaxed ) + newer.intervalSum.load( std::memory_order_relaxed ) ) / 1e9, snapshot.window );
+		if (intervals > 0 && duration > 0) snapshot.fps = double( intervals ) / duration;
+
+		for (int m = 0; m < METRIC_COUNT; m++) {
+
+			StatsPercentiles & out = snapshot.metrics[m];
+
+			std::vector<uint64_t> counts( BUCKETS );
+			for (int i = 0; i < BUCKETS; i++) {
+				counts[i] = older.buckets[m][i].load( std::memory_order_relaxed ) + newer.buckets[m][i].load( std::memory_order_relaxed );
+				out.count += counts[i];
+			}
+			out.max = std::max( older.max[m].load( std::memory_order_relaxed ), newer.max[m].load( std::memory_order_relaxed ) ) / 1e6;
+			if (out.count == 0) continue;
+
+			uint64_t p50 = (out.count + 1) / 2;
+			uint64_t p99 = out.count - out.count / 100;
+			uint64_t seen = 0;
+			bool found50 = false;
+
+			for (int i = 0; i < BUCKETS; i++) {
+				if (counts[i] == 0) continue;
+				seen += counts[i];
+				double upper = std::min( double( bucketUpper( i ) ) / 1e6, out.max );
+				out.histogram.emplace_back( upper, counts[i] );
+				if (!found50 && seen >= p50) {
+					out.p50 = upper;
+					found50 = true;
+				}
+				if (out.p99 == 0 && seen >= p99) out.p99 = upper;
+			}
+		}
+
+		return snapshot;
+	}
+
+	std::string StatsCollector::MetricToString( StatsMetric metric ) {
+		switch (metric) {
+			case METRIC_INTERVAL: return "interval";
+			case METRIC_CONVERSION: return "conversion";
+			case METRIC_CALLBACK: return "callback";
+			case METRIC_LATENCY: return "latency";
+			default: return "unknown";
+		}
+	}
+
+	std::string StatsCollector::BufferStatusToString( ArvBufferStatus status ) {
+		switch (status) {
+			case ARV_BUFFER_STATUS_SUCCESS: return "success";
+			case ARV_BUFFER_STATUS_CLEARED: return "cleared";
+			case ARV_BUFFER_STATUS_TIMEOUT: return "timeout";
+			case ARV_BUFFER_STATUS_MISSING_PACKETS: return "missingPackets";
+			case ARV_BUFFER_STATUS_WRONG_PACKET_ID: return "wrongPacketId";
+			case ARV_BUFFER_STATUS_SIZE_MISMATCH: return "sizeMismatch";
+			case ARV_BUFFER_STATUS_FILLING: return "filling";
+			case ARV_BUFFER_STATUS_ABORTED: return "aborted";
+			case ARV_BUFFER_STATUS_PAYLOAD_NOT_SUPPORTED: return "payloadNotSupported";
+			default: return "unknown";
+		}
+	}
+
+	ofJson StatsSnapshot::toJson( bool histograms ) const {
+
+		ofJson json;
+		json["window"] = window;
+		json["fps"] = fps;
+		json["frames"] = frames;
+		json["dropped"] = dropped;
+
+		for (int m = 0; m < METRIC_COUNT; m++) {
+			const StatsPercentiles & metric = metrics[m];
+			ofJson & entry = json[StatsCollector::MetricToString( StatsMetric( m ) )];
+			entry["count"] = metric.count;
+			entry["p50"] = metric.p50;
+			entry["p99"] = metric.p99;
+			entry["max"] = metric.max;
+			if (histograms) {
+				entry["histogram"] = ofJson::array();
+				for (auto & bucket : metric.histogram) entry["histogram"].push_back( { { "ms", bucket.first }, { "count", bucket.second } } );
+			}
+		}
+
+		for (int i = 0; i < 10; i++) {
+			if (bufferStatus[i] > 0) json["buffers"][StatsCollector::BufferStatusToString( ArvBufferStatus( i - 1 ) )] = bufferStatus[i];
+		}
+
+		return json;
+	}
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <arv.h>
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <chrono>
+
+namespace ofxAravis {
+
+    // ------- STATS -------
+
+    // Rolling performance statistics. Recording is lock-free (relaxed atomics only), so it can sit
+    // on the stream thread and in conversion workers. Samples go into log-scale histograms
+    // (8 buckets per power of two, percentiles within 12.5%) that rotate every window,
+    // a snapshot covers the current and the previous window.
+
+    enum StatsMetric {
+        METRIC_INTERVAL, // time between frames arriving
+        METRIC_CONVERSION, // pixel conversion per frame
+        METRIC_CALLBACK, // user callbacks per frame
+        METRIC_LATENCY, // last packet arriving to delivery
+        METRIC_COUNT
+    };
+
+    struct StatsPercentiles {
+        uint64_t count = 0;
+        double p50 = 0; // ms
+        double p99 = 0;
+        double max = 0;
+        std::vector<std::pair<double, uint64_t>> histogram; // bucket upper bound in ms, count, empty buckets skipped
+    };
+
+    struct StatsSnapshot {
+        double window = 0; // seconds covered by the snapshot
+        double fps = 0;
+        uint64_t frames = 0; // since reset
+        uint64_t dropped = 0; // frame id gaps, filled in by the owner
+        std::array<StatsPercentiles, METRIC_COUNT> metrics;
+        std::array<uint64_t, 10> bufferStatus {}; // ArvBufferStatus + 1, since reset
+
+        const StatsPercentiles & get( StatsMetric metric ) const { return metrics[metric]; }
+        ofJson toJson( bool histograms = false ) const;
+    };
+
+    class StatsCollector {
+        public:
+            StatsCollector();
+
+            void setWindow( double seconds ); // default 1 second
+            void reset();
+
+            static uint64_t Now(); // steady clock ns
+
+            void frameArrived( uint64_t now = Now() ); // single producer, records METRIC_INTERVAL
+            void record( StatsMetric metric, uint64_t ns );
+            void bufferStatus( ArvBufferStatus status );
+
+            StatsSnapshot getSnapshot();
+
+            static std::string MetricToString( StatsMetric metric );
+            static std::string BufferStatusToString( ArvBufferStatus status );
+
+        private:
+            static const int SUB_BUCKETS = 8;
+            static const int BUCKETS = 64 * SUB_BUCKETS;
+
+            static int bucketIndex( uint64_t ns );
+            static uint64_t bucketUpper( int index );
+
+            struct Epoch {
+                std::atomic<uint64_t> start { 0 };
+                std::atomic<uint64_t> intervalSum { 0 };
+                std::atomic<uint64_t> max[METRIC_COUNT];
+                std::atomic<uint64_t> buckets[METRIC_COUNT][BUCKETS];
+                void clear( uint64_t now );
+            };
+
+            void rotate( uint64_t now );
+
+            Epoch epochs[2];
+            std::atomic<int> current { 0 };
+            std::atomic<bool> rotating { false };
+            std::atomic<uint64_t> windowNs { 1000000000ull };
+
+            std::atomic<uint64_t> lastArrival { 0 };
+            std::atomic<uint64_t> frames { 0 };
+            std::atomic<uint64_t> statuses[10];
+    };
+
+}
@@ -0,0 +1,226 @@
+#include "ofxAravis_sync.h"
+
+#include <chrono>
+
+namespace ofxAravis {
+
+	namespace {
+
+		uint64_t Now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+		}
+
+		guint64 difference( guint64 a, guint64 b ) {
+			return a > b ? a - b : b - a;
+		}
+
+	}
+
+	// ------- FRAME SYNCHRONIZER -------
+
+	FrameSynchronizer::~FrameSynchronizer() {
+		stop();
+	}
+
+	void FrameSynchronizer::setup( SyncSettings s, FrameSetCallback c ) {
+
+		stop();
+
+		std::lock_guard<std::mutex> lock( mutex );
+		settings = s;
+		if (settings.streams < 1) settings.streams = 1;
+		if (settings.maxPending < 1) settings.maxPending = 1;
+		callback = c;
+		lastSequence.assign( settings.streams, 0 );
+		closed.clear();
+		nextSequence = 1;
+		stats = SyncStats();
+		running = true;
+		thread = std::thread( &FrameSynchronizer::threadedFunction, this );
+	}
+
+	void FrameSynchronizer::stop() {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (!running) return;
+			running = false;
+			pending.clear();
+		}
+		wake.notify_all();
+		if (thread.joinable()) thread.join();
+	}
+
+	guint64 FrameSynchronizer::stampOf( int stream, const Frame & frame ) {
+		if (settings.match == SYNC_SYSTEM_TIMESTAMP || frame.timestamp == 0) return frame.systemTimestamp;
+		ClockModel * clock = stream < int( settings.clocks.size() ) ? settings.clocks[stream] : nullptr;
+		return clock ? clock->toHost( frame.timestamp ) : frame.timestamp;
+	}
+
+	guint64 FrameSynchronizer::keyOf( int stream, const Frame & frame ) {
+		return settings.match == SYNC_FRAME_ID ? frame.frameId : stampOf( stream, frame );
+	}
+
+	bool FrameSynchronizer::matches( guint64 key, guint64 frameKey ) {
+		if (settings.match == SYNC_FRAME_ID) return key == frameKey;
+		return difference( key, frameKey ) <= guint64( settings.tolerance * 1e6 );
+	}
+
+	void FrameSynchronizer::push( int stream, const FrameLease & frame ) {
+
+		std::vector<FrameSet> emit;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+
+			if (!running || !frame || stream < 0 || stream >= settings.streams) return;
+
+			guint64 key = keyOf( stream, *frame );
+
+			for (guint64 done : closed) {
+				if (matches( done, key )) {
+					stats.late += 1;
+					return;
+				}
+			}
+
+			// the open set this stream hasn't filled yet whose key is closest
+
+			auto best = pending.end();
+			for (auto it = pending.begin(); it != pending.end(); ++it) {
+				if (it->set.frames[stream] || !matches( it->set.key, key )) continue;
+				if (best == pending.end() || difference( it->set.key, key ) < difference( best->set.key, key )) best = it;
+			}
+
+			if (best == pending.end()) {
+				if (pending.size() >= settings.maxPending) close( pending.begin(), false, emit );
+				Pending opened;
+				opened.set.frames.resize( settings.streams );
+				opened.set.key = key;
+				opened.sequence = nextSequence++;
+				opened.opened = Now();
+				opened.earliest = opened.latest = stampOf( stream, *frame );
+				pending.push_back( opened );
+				best = std::prev( pending.end() );
+				wake.notify_one(); // new deadline
+			}
+
+			guint64 stamp = stampOf( stream, *frame );
+			best->set.frames[stream] = frame;
+			best->set.count += 1;
+			best->earliest = std::min( best->earliest, stamp );
+			best->latest = std::max( best->latest, stamp );
+			lastSequence[stream] = best->sequence;
+
+			if (best->set.isComplete()) close( best, false, emit );
+			closeHopeless( emit );
+		}
+
+		emitAll( emit );
+	}
+
+	FrameCallback FrameSynchronizer::getCallback( int stream ) {
+		return [this, stream]( const FrameLease & frame ) { push( stream, frame ); };
+	}
+
+	void FrameSynchronizer::flush() {
+		std::vector<FrameSet> emit;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			while (!pending.empty()) close( pending.begin(), false, emit );
+		}
+		emitAll( emit );
+	}
+
+	void FrameSynchronizer::close( std::list<Pending>::iterator it, bool timedOut, std::vector<FrameSet> & emit ) {
+
+		it->set.spread = it->latest - it->earliest;
+		closed.push_back( it->set.key );
+		while (closed.size() > settings.maxPending * 2) closed.pop_front();
+
+		if (it->set.isComplete()) {
+			stats.complete += 1;
+			emit.push_back( std::move( it->set ) );
+		} else {
+			if (timedOut) stats.timeouts += 1;
+			if (settings.partial == SYNC_EMIT_PARTIAL) {
+				stats.partial += 1;
+				emit.push_back( std::move( it->set ) );
+			} else {
+				stats.dropped += 1;
+			}
+		}
+
+		pending.erase( it );
+	}
+
+	// streams deliver in order, a stream that has moved on to a newer set never fills an older one
+
+	void FrameSynchronizer::closeHopeless( std::vector<FrameSet> & emit ) {
+		for (auto it = pending.begin(); it != pending.end();) {
+			bool hopeless = true;
+			for (int stream = 0; stream < settings.streams && hopeless; stream++) {
+				if (!it->set.frames[stream] && lastSequence[stream] <= it->sequence) hopeless = false;
+			}
+			auto next = std::next( it );
+			if (hopeless) close( it, false, emit );
+			it = next;
+		}
+	}
+
+	void FrameSynchronizer::emitAll( std::vector<FrameSet> & emit ) {
+		if (!callback) return;
+		for (auto & set : emit) callback( set );
+	}
+
+	SyncStats FrameSynchronizer::getStats() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return stats;
+	}
+
+	size_t FrameSynchronizer::getPending() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return pending.size();
+	}
+
+	// gives up sets whose missing frames never came, pushes handle everything else
+
+	void FrameSynchronizer::threadedFunction() {
+
+		std::unique_lock<std::mutex> lock( mutex );
+
+		while (running) {
+
+			if (pending.empty()) {
+				wake.wait( lock );
+				continue;
+			}
+
+			uint64_t timeout = uint64_t( settings.timeout * 1e6 );
+			uint64_t deadline = pending.front().opened + timeout; // sets open in order, the front expires first
+			uint64_t now = Now();
+
+			if (now < deadline) {
+				wake.wait_for( lock, std::chrono::nanoseconds( deadline - now ) );
+				continue;
+			}
+
+			std::vector<FrameSet> emit;
+			while (!pending.empty() && pending.front().opened + timeout <= now) close( pending.begin(), true, emit );
+
+			lock.unlock();
+			emitAll( emit );
+			lock.lock();
+		}
+	}
+
+	ofJson SyncStats::toJson() const {
+		ofJson json;
+		json["complete"] = complete;
+		json["partial"] = partial;
+		json["dropped"] = dropped;
+		json["timeouts"] = timeouts;
+		json["late"] = late;
+		json["incomplete"] = incomplete();
+		return json;
+	}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxAravis_frame.h"
+#include "ofxAravis_clock.h"
+
+#include <list>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+namespace ofxAravis {
+
+    // ------- FRAME SYNCHRONIZER -------
+
+    // Collects frames from N streams (one Grabber frame callback each, see getCallback) and emits
+    // them as sets taken at the same trigger. Frames match by frame id, which needs the cameras to
+    // have started counting together, or by timestamp within a tolerance, which needs a shared
+    // clock for device timestamps (PTP, or a ClockModel per stream) or comparable transport
+    // delays for host timestamps.
+    //
+    // Each stream delivers in order, so a set is given up as soon as every stream it is still
+    // missing has delivered a frame for a newer set; the timeout only matters when a camera goes
+    // quiet. Given up sets are emitted or dropped by the partial policy, and counted either way.
+    // The callback runs on whichever thread closed the set, outside the lock.
+
+    enum SyncMatch {
+        SYNC_FRAME_ID,
+        SYNC_TIMESTAMP, // device timestamp, host timestamp for frames without one
+        SYNC_SYSTEM_TIMESTAMP // host time the last packet arrived
+    };
+
+    enum SyncPartial {
+        SYNC_DROP_PARTIAL,
+        SYNC_EMIT_PARTIAL // missing frames are nullptr
+    };
+
+    struct SyncSettings {
+        int streams = 2;
+        SyncMatch match = SYNC_FRAME_ID;
+        double tolerance = 1; // ms between the first and any other frame of a set, timestamp matching
+        double timeout = 100; // ms a set waits for its missing frames after its first one arrived
+        SyncPartial partial = SYNC_DROP_PARTIAL;
+        size_t maxPending = 8; // open sets, the oldest is given up when more start
+        std::vector<ClockModel *> clocks; // per stream, SYNC_TIMESTAMP maps device timestamps to the host clock first, see Grabber::getClockModel
+    };
+
+    struct FrameSet {
+        std::vector<FrameLease> frames; // by stream, nullptr for frames a partial set is missing
+        guint64 key = 0; // frame id or timestamp of the first frame
+        int count = 0; // frames present
+        guint64 spread = 0; // ns between the earliest and latest timestamp of the set
+        bool isComplete() const { return count == int( frames.size() ); }
+    };
+
+    using FrameSetCallback = std::function<void(const FrameSet & set)>;
+
+    struct SyncStats {
+        uint64_t complete = 0;
+        uint64_t partial = 0; // incomplete sets emitted
+        uint64_t dropped = 0; // incomplete sets dropped
+        uint64_t timeouts = 0; // incomplete sets given up by the timeout, part of partial or dropped
+        uint64_t late = 0; // frames that arrived after their set was closed, discarded
+        uint64_t incomplete() const { return partial + dropped; }
+        ofJson toJson() const;
+    };
+
+    class FrameSynchronizer {
+        public:
+            ~FrameSynchronizer();
+
+            void setup( SyncSettings settings, FrameSetCallback callback );
+            void stop(); // open sets are discarded, uncounted
+
+            void push( int stream, const FrameLease & frame ); // any thread
+            FrameCallback getCallback( int stream ); // for Grabber::setFrameCallback
+            void flush(); // gives up every open set now
+
+            SyncStats getStats();
+            size_t getPending();
+
+        private:
+            struct Pending {
+                FrameSet set;
+                uint64_t sequence = 0; // order the sets were opened in
+                uint64_t opened = 0; // steady clock ns
+                guint64 earliest = 0; // timestamps, for the spread
+                guint64 latest = 0;
+            };
+
+            guint64 stampOf( int stream, const Frame & frame );
+            guint64 keyOf( int stream, const Frame & frame );
+            bool matches( guint64 key, guint64 frameKey );
+            void close( std::list<Pending>::iterator it, bool timedOut, std::vector<FrameSet> & emit );
+            void closeHopeless( std::vector<FrameSet> & emit );
+            void emitAll( std::vector<FrameSet> & emit );
+            void threadedFunction();
+
+            SyncSettings settings;
+            FrameSetCallback callback;
+
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::list<Pending> pending; // oldest first
+            std::vector<uint64_t> lastSequence; // per stream, the set its last frame went to
+            std::deque<guint64> closed; // keys of recently closed sets, to recognise late frames
+            uint64_t nextSequence = 1;
+            SyncStats stats;
+            bool running = false;
+            std::thread thread;
+    };
+
+}
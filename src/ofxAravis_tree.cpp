@@ -0,0 +1,406 @@
+#include "ofxAravis_tree.h"
+
+#include <algorithm>
+
+namespace ofxAravis {
+
+	namespace {
+
+		// descriptions and units are optional in the XML
+		std::string orEmpty( const char * chars ) {
+			return chars ? chars : "";
+		}
+
+		// every read gets a clean error, one that fails is null and doesn't mask the next
+		template<typename T> ofJson orNull( T value, GError ** err ) {
+			if (!*err) return value;
+			g_clear_error( err );
+			return nullptr;
+		}
+
+		const int MAX_DEPTH = 64; // categories form a DAG, this only guards against broken XML
+
+		// pIsLocked, pIsAvailable and pInvalidator, then the variables of any formula in between:
+		// ExposureTime -> pIsLocked -> a SwissKnife -> pVariable -> ExposureAuto
+
+		void collectDependencies( ArvGcNode * node, std::vector<std::string> & names, int depth ) {
+
+			if (depth > 3) return;
+
+			for (ArvDomNode * child = arv_dom_node_get_first_child( ARV_DOM_NODE( node ) ); child; child = arv_dom_node_get_next_sibling( child )) {
+
+				if (!ARV_IS_GC_PROPERTY_NODE( child )) continue;
+				ArvGcPropertyNodeType type = arv_gc_property_node_get_node_type( ARV_GC_PROPERTY_NODE( child ) );
+				bool follow = depth == 0
+					? type == ARV_GC_PROPERTY_NODE_TYPE_P_IS_LOCKED || type == ARV_GC_PROPERTY_NODE_TYPE_P_IS_AVAILABLE || type == ARV_GC_PROPERTY_NODE_TYPE_P_INVALIDATOR
+					: type == ARV_GC_PROPERTY_NODE_TYPE_P_VARIABLE || type == ARV_GC_PROPERTY_NODE_TYPE_P_VALUE;
+				if (!follow) continue;
+
+				ArvGcNode * linked = arv_gc_property_node_get_linked_node( ARV_GC_PROPERTY_NODE( child ) );
+				if (!linked || !ARV_IS_GC_FEATURE_NODE( linked )) continue;
+				std::string name = orEmpty( arv_gc_feature_node_get_name( ARV_GC_FEATURE_NODE( linked ) ) );
+				if (name.empty() || std::find( names.begin(), names.end(), name ) != names.end()) continue;
+
+				names.push_back( name );
+				collectDependencies( linked, names, depth + 1 );
+			}
+		}
+
+	}
+
+	// ------- FEATURE TREE -------
+
+	bool FeatureTree::build( ArvGc * genicam, const std::string & root, int maxDepth ) {
+
+		clear();
+		if (!genicam) return false;
+
+		ArvGcNode * node = arv_gc_get_node( genicam, root.c_str() );
+		if (!node || !ARV_IS_GC_FEATURE_NODE( node )) return false;
+
+		entries.reserve( 512 );
+		addNode( genicam, node, root, -1, 0, maxDepth );
+		return true;
+	}
+
+	void FeatureTree::addNode( ArvGc * genicam, ArvGcNode * node, const std::string & name, int parent, int depth, int maxDepth ) {
+
+		ArvGcFeatureNode * feature = ARV_GC_FEATURE_NODE( node );
+
+		int i = int( entries.size() );
+		entries.emplace_back();
+
+		{
+			Entry & entry = entries.back();
+			entry.name = name;
+			entry.nodeType = orEmpty( arv_dom_node_get_node_name( ARV_DOM_NODE( node ) ) );
+			entry.node = node;
+			entry.type = GetFeatureType( node );
+			entry.isCategory = ARV_IS_GC_CATEGORY( node );
+			entry.isSelector = ARV_IS_GC_SELECTOR( node ) && arv_gc_selector_is_selector( ARV_GC_SELECTOR( node ) );
+			entry.parent = parent;
+			entry.depth = depth;
+			entry.description = orEmpty( arv_gc_feature_node_get_description( feature ) );
+
+			if (entry.type == FEATURE_INTEGER) entry.unit = orEmpty( arv_gc_integer_get_unit( ARV_GC_INTEGER( node ) ) );
+			else if (entry.type == FEATURE_FLOAT) entry.unit = orEmpty( arv_gc_float_get_unit( ARV_GC_FLOAT( node ) ) );
+
+			if (entry.type == FEATURE_ENUMERATION) {
+				for (const GSList * iter = arv_gc_enumeration_get_entries( ARV_GC_ENUMERATION( node ) ); iter != NULL; iter = iter->next) {
+					EnumEntry option;
+					option.node = ARV_GC_NODE( iter->data );
+					option.name = orEmpty( arv_gc_feature_node_get_name( ARV_GC_FEATURE_NODE( iter->data ) ) );
+					option.nodeType = orEmpty( arv_dom_node_get_node_name( ARV_DOM_NODE( iter->data ) ) );
+					entry.enumEntries.push_back( option );
+				}
+			}
+
+			if (entry.isSelector) {
+				for (const GSList * iter = arv_gc_selector_get_selected_features( ARV_GC_SELECTOR( node ) ); iter != NULL; iter = iter->next) {
+					entry.selected.push_back( orEmpty( arv_gc_feature_node_get_name( ARV_GC_FEATURE_NODE( iter->data ) ) ) );
+				}
+			}
+
+			if (!entry.isCategory) collectDependencies( node, entry.dependsOn, 0 );
+		}
+
+		if (index.find( name ) == index.end()) index[name] = i;
+
+		// entries may reallocate below, so everything after this point goes through the index
+
+		if (!entries[i].isCategory || depth >= MAX_DEPTH) return;
+		if (maxDepth >= 0 && depth >= maxDepth) return;
+
+		for (const GSList * iter = arv_gc_category_get_features( ARV_GC_CATEGORY( node ) ); iter != NULL; iter = iter->next) {
+			const char * childName = static_cast<const char *>( iter->data );
+			ArvGcNode * child = arv_gc_get_node( genicam, childName );
+			if (!child || !ARV_IS_GC_FEATURE_NODE( child )) continue;
+			int c = int( entries.size() );
+			entries[i].children.push_back( c );
+			addNode( genicam, child, childName, i, depth + 1, maxDepth );
+		}
+	}
+
+	FeatureTree FeatureTree::subtree( const std::string & root, int maxDepth ) const {
+		FeatureTree tree;
+		int i = find( root );
+		if (i < 0) return tree;
+		tree.copyNode( *this, i, -1, 0, maxDepth );
+		return tree;
+	}
+
+	void FeatureTree::copyNode( const FeatureTree & from, int i, int parent, int depth, int maxDepth ) {
+
+		int c = int( entries.size() );
+		entries.push_back( from.entries[i] );
+		entries[c].parent = parent;
+		entries[c].depth = depth;
+		entries[c].children.clear();
+		if (index.find( entries[c].name ) == index.end()) index[entries[c].name] = c;
+
+		if (maxDepth >= 0 && depth >= maxDepth) return;
+
+		for (int child : from.entries[i].children) {
+			entries[c].children.push_back( int( entries.size() ) );
+			copyNode( from, child, c, depth + 1, maxDepth );
+		}
+	}
+
+	void FeatureTree::clear() {
+		entries.clear();
+		index.clear();
+	}
+
+	void FeatureTree::readValues( FeatureCache & cache ) {
+
+		std::lock_guard<std::recursive_mutex> control( cache.getControlMutex() );
+
+		// a feature listed under several categories is read once
+		std::unordered_map<ArvGcNode *, int> seen;
+
+		for (int i = 0; i < int( entries.size() ); i++) {
+
+			Entry & entry = entries[i];
+
+			auto it = seen.find( entry.node );
+			if (it != seen.end()) {
+				const Entry & first = entries[it->second];
+				entry.hasValues = true;
+				entry.isImplemented = first.isImplemented;
+				entry.isAvailable = first.isAvailable;
+				entry.accessMode = first.accessMode;
+				entry.value = first.value;
+				entry.min = first.min;
+				entry.max = first.max;
+				entry.increment = first.increment;
+				entry.enumEntries = first.enumEntries;
+				continue;
+			}
+			seen[entry.node] = i;
+
+			ArvGcNode * node = entry.node;
+			ArvGcFeatureNode * feature = ARV_GC_FEATURE_NODE( node );
+			GError * err = nullptr;
+
+			entry.hasValues = true;
+			entry.isImplemented = arv_gc_feature_node_is_implemented( feature, nullptr );
+			entry.isAvailable = entry.isImplemented && arv_gc_feature_node_is_available( feature, nullptr );
+			if (!entry.isAvailable) continue;
+
+			entry.accessMode = arv_gc_feature_node_get_actual_access_mode( feature );
+
+			for (auto & option : entry.enumEntries) {
+				option.isImplemented = arv_gc_feature_node_is_implemented( ARV_GC_FEATURE_NODE( option.node ), nullptr );
+				option.isAvailable = option.isImplemented && arv_gc_feature_node_is_available( ARV_GC_FEATURE_NODE( option.node ), nullptr );
+			}
+
+			bool readable = entry.accessMode == ARV_GC_ACCESS_MODE_RO || entry.accessMode == ARV_GC_ACCESS_MODE_RW;
+			if (!readable || entry.isCategory) continue;
+
+			// a value or bound that fails to read stays null, the rest of the pass carries on
+			switch (entry.type) {
+				case FEATURE_INTEGER:
+					entry.value = orNull( arv_gc_integer_get_value( ARV_GC_INTEGER( node ), &err ), &err );
+					entry.min = orNull( arv_gc_integer_get_min( ARV_GC_INTEGER( node ), &err ), &err );
+					entry.max = orNull( arv_gc_integer_get_max( ARV_GC_INTEGER( node ), &err ), &err );
+					entry.increment = orNull( arv_gc_integer_get_inc( ARV_GC_INTEGER( node ), &err ), &err );
+					break;
+				case FEATURE_FLOAT:
+					entry.value = orNull( arv_gc_float_get_value( ARV_GC_FLOAT( node ), &err ), &err );
+					entry.min = orNull( arv_gc_float_get_min( ARV_GC_FLOAT( node ), &err ), &err );
+					entry.max = orNull( arv_gc_float_get_max( ARV_GC_FLOAT( node ), &err ), &err );
+					entry.increment = orNull( arv_gc_float_get_inc( ARV_GC_FLOAT( node ), &err ), &err );
+					break;
+				case FEATURE_BOOLEAN:
+					entry.value = orNull( bool( arv_gc_boolean_get_value( ARV_GC_BOOLEAN( node ), &err ) ), &err );
+					break;
+				case FEATURE_STRING:
+				case FEATURE_ENUMERATION:
+					entry.value = orNull( orEmpty( arv_gc_string_get_value( ARV_GC_STRING( node ), &err ) ), &err );
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+	int FeatureTree::find( const std::string & name ) const {
+		auto it = index.find( name );
+		return it == index.end() ? -1 : it->second;
+	}
+
+	const FeatureTree::Entry & FeatureTree::operator[]( int i ) const {
+		return entries[i];
+	}
+
+	const std::vector<FeatureTree::Entry> & FeatureTree::getEntries() const {
+		return entries;
+	}
+
+	size_t FeatureTree::size() const {
+		return entries.size();
+	}
+
+	bool FeatureTree::empty() const {
+		return entries.empty();
+	}
+
+	ofJson FeatureTree::toJson() const {
+
+		ofJson json = ofJson::array();
+
+		for (int i = 0; i < int( entries.size() ); i++) {
+
+			const Entry & entry = entries[i];
+			ofJson item;
+			item["index"] = i;
+			item["parent"] = entry.parent;
+			item["depth"] = entry.depth;
+			item["featureName"] = entry.name;
+			item["nodeType"] = entry.nodeType;
+			item["type"] = entry.isCategory ? "category" : FeatureTypeToString( entry.type );
+			if (!entry.children.empty()) item["children"] = entry.children;
+			if (!entry.description.empty()) item["description"] = entry.description;
+			if (!entry.unit.empty()) item["unit"] = entry.unit;
+			if (!entry.selected.empty()) item["options"] = entry.selected;
+			if (!entry.dependsOn.empty()) item["dependsOn"] = entry.dependsOn;
+
+			if (!entry.enumEntries.empty()) {
+				item["enum"] = ofJson::array();
+				for (auto & option : entry.enumEntries) {
+					if (entry.hasValues && !option.isImplemented) continue;
+					ofJson o;
+					o["featureName"] = option.name;
+					o["nodeType"] = option.nodeType;
+					if (entry.hasValues) o["isAvailable"] = option.isAvailable;
+					item["enum"].push_back( o );
+				}
+			}
+
+			if (entry.hasValues) {
+				item["isImplemented"] = entry.isImplemented;
+				item["isAvailable"] = entry.isAvailable;
+				if (entry.isAvailable) item["accessMode"] = orEmpty( arv_gc_access_mode_to_string( entry.accessMode ) );
+				if (!entry.value.is_null()) item["value"] = entry.value;
+				if (!entry.min.is_null()) item["min"] = entry.min;
+				if (!entry.max.is_null()) item["max"] = entry.max;
+				if (!entry.increment.is_null()) item["increment"] = entry.increment;
+			}
+
+			json.push_back( item );
+		}
+
+		return json;
+	}
+
+	bool FeatureTree::fromJson( const ofJson & json, ArvGc * genicam ) {
+
+		clear();
+		if (!genicam || !json.is_array() || json.empty()) return false;
+
+		entries.reserve( json.size() );
+
+		for (auto & item : json) {
+
+			Entry entry;
+			entry.name = item.value( "featureName", "" );
+			entry.node = arv_gc_get_node( genicam, entry.name.c_str() );
+			if (!entry.node || !ARV_IS_GC_FEATURE_NODE( entry.node )) {
+				clear();
+				return false;
+			}
+
+			// everything that is cheap to ask the node for is not trusted to the json
+			entry.type = GetFeatureType( entry.node );
+			entry.isCategory = ARV_IS_GC_CATEGORY( entry.node );
+			entry.isSelector = ARV_IS_GC_SELECTOR( entry.node ) && arv_gc_selector_is_selector( ARV_GC_SELECTOR( entry.node ) );
+
+			entry.nodeType = item.value( "nodeType", "" );
+			entry.parent = item.value( "parent", -1 );
+			entry.depth = item.value( "depth", 0 );
+			entry.description = item.value( "description", "" );
+			entry.unit = item.value( "unit", "" );
+			if (item.count( "children" )) entry.children = item["children"].get<std::vector<int>>();
+			if (item.count( "options" )) entry.selected = item["options"].get<std::vector<std::string>>();
+			if (item.count( "dependsOn" )) entry.dependsOn = item["dependsOn"].get<std::vector<std::string>>();
+
+			if (item.count( "enum" )) {
+				for (auto & o : item["enum"]) {
+					EnumEntry option;
+					option.name = o.value( "featureName", "" );
+					option.nodeType = o.value( "nodeType", "" );
+					option.node = arv_gc_get_node( genicam, option.name.c_str() );
+					if (!option.node || !ARV_IS_GC_FEATURE_NODE( option.node )) {
+						clear();
+						return false;
+					}
+					entry.enumEntries.push_back( option );
+				}
+			}
+
+			if (index.find( entry.name ) == index.end()) index[entry.name] = int( entries.size() );
+			entries.push_back( entry );
+		}
+
+		for (auto & entry : entries) {
+			for (int child : entry.children) {
+				if (child <= 0 || child >= int( entries.size() )) {
+					clear();
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	ofJson FeatureTree::toNestedJson() const {
+		if (entries.empty()) return ofJson();
+		return nestedEntry( 0 );
+	}
+
+	ofJson FeatureTree::nestedEntry( int i ) const {
+
+		const Entry & entry = entries[i];
+		ofJson json;
+
+		json["nodeType"] = entry.nodeType;
+		json["featureName"] = entry.name;
+
+		if (entry.hasValues && entry.isAvailable) {
+			json["accessMode"] = orEmpty( arv_gc_access_mode_to_string( entry.accessMode ) );
+			if (!entry.value.is_null()) json["value"] = entry.value;
+			if (!entry.min.is_null()) json["min"] = entry.min;
+			if (!entry.max.is_null()) json["max"] = entry.max;
+			if (!entry.increment.is_null()) json["increment"] = entry.increment;
+		}
+		if (!entry.unit.empty()) json["unit"] = entry.unit;
+		if (!entry.selected.empty()) json["options"] = entry.selected;
+		if (!entry.dependsOn.empty()) json["dependsOn"] = entry.dependsOn;
+
+		json["description"] = entry.description.empty() ? "N/A" : entry.description;
+
+		if (entry.type == FEATURE_ENUMERATION) {
+			json["enum"] = ofJson::array();
+			for (auto & option : entry.enumEntries) {
+				if (!option.isImplemented) continue;
+				ofJson o;
+				o["nodeType"] = option.nodeType;
+				o["featureName"] = option.name;
+				if (entry.hasValues) o["isAvailable"] = option.isAvailable;
+				json["enum"].push_back( o );
+			}
+		}
+
+		if (entry.isCategory) {
+			json["children"] = ofJson::array();
+			for (int child : entry.children) {
+				if (entries[child].hasValues && !entries[child].isImplemented) continue;
+				json["children"].push_back( nestedEntry( child ) );
+			}
+		}
+
+		return json;
+	}
+
+}
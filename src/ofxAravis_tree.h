@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ofxAravis_features.h"
+
+#include <vector>
+
+namespace ofxAravis {
+
+    // ------- FEATURE TREE -------
+
+    // The GenICam category tree flattened into one vector, parents before their children.
+    // build() only walks the XML DOM, nothing is read from the device, so it is cheap enough
+    // to run when a settings UI opens. readValues() is a separate pass that fills in access
+    // modes, availability, values and bounds.
+
+    struct FeatureTreeOptions {
+        std::string root = "Root"; // category (or single feature) to start from
+        int maxDepth = -1; // levels below root, -1 = all
+        bool values = false; // also run readValues()
+    };
+
+    class FeatureTree {
+        public:
+            struct EnumEntry {
+                std::string name;
+                std::string nodeType;
+                ArvGcNode * node = nullptr;
+                bool isImplemented = true; // set by readValues()
+                bool isAvailable = true;
+            };
+
+            struct Entry {
+                std::string name;
+                std::string nodeType; // xml element, e.g. "Category", "Integer", "Enumeration"
+                ArvGcNode * node = nullptr;
+                FeatureType type = FEATURE_UNKNOWN;
+                bool isCategory = false;
+                bool isSelector = false;
+                int parent = -1; // index, -1 for the root
+                int depth = 0;
+                std::vector<int> children; // indices
+                std::string description;
+                std::string unit;
+                std::vector<EnumEntry> enumEntries;
+                std::vector<std::string> selected; // features driven by this selector
+                std::vector<std::string> dependsOn; // nodes that lock, hide or invalidate this one, e.g. ExposureAuto for ExposureTime
+
+                // filled by readValues()
+                bool hasValues = false;
+                bool isImplemented = true;
+                bool isAvailable = true;
+                ArvGcAccessMode accessMode = ARV_GC_ACCESS_MODE_UNDEFINED;
+                ofJson value;
+                ofJson min;
+                ofJson max;
+                ofJson increment;
+            };
+
+            bool build( ArvGc * genicam, const std::string & root = "Root", int maxDepth = -1 );
+            FeatureTree subtree( const std::string & root, int maxDepth = -1 ) const; // copy without touching the DOM
+            void clear();
+
+            // one pass under the control lock, every readable node read once
+            void readValues( FeatureCache & cache );
+
+            int find( const std::string & name ) const; // first occurrence, -1 if missing
+            const Entry & operator[]( int index ) const;
+            const std::vector<Entry> & getEntries() const;
+            size_t size() const;
+            bool empty() const;
+
+            ofJson toJson() const; // flat array, children as indices
+            // rebuilds a structure from toJson(), nodes are looked up by name in genicam;
+            // false when any of them is missing, i.e. the json came from a different model
+            bool fromJson( const ofJson & json, ArvGc * genicam );
+            ofJson toNestedJson() const; // the listAllFeatures shape
+
+        private:
+            void addNode( ArvGc * genicam, ArvGcNode * node, const std::string & name, int parent, int depth, int maxDepth );
+            void copyNode( const FeatureTree & from, int index, int parent, int depth, int maxDepth );
+            ofJson nestedEntry( int index ) const;
+
+            std::vector<Entry> entries;
+            std::unordered_map<std::string, int> index;
+    };
+
+}
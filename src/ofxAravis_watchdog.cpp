@@ -0,0 +1,225 @@
+#include "ofxAravis_watchdog.h"
+
+#include <chrono>
+
+namespace ofxAravis {
+
+	namespace {
+
+		uint64_t Now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+		}
+
+		std::string CauseToString( RecoveryCause cause ) {
+			return cause == RECOVERY_CONTROL_LOST ? "controlLost" : "frameTimeout";
+		}
+
+	}
+
+	// ------- WATCHDOG -------
+
+	Watchdog::~Watchdog() {
+		stop();
+	}
+
+	void Watchdog::start( WatchdogSettings s, Recover r ) {
+
+		stop();
+
+		std::lock_guard<std::mutex> lock( mutex );
+		settings = s;
+		recover = r;
+		armed = false;
+		controlLost = false;
+		running = true;
+		thread = std::thread( &Watchdog::threadedFunction, this );
+	}
+
+	void Watchdog::stop() {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (!running) return;
+			running = false;
+		}
+		wake.notify_all();
+		if (thread.joinable()) thread.join();
+		unwatch();
+	}
+
+	bool Watchdog::isRunning() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return running;
+	}
+
+	void Watchdog::watch( ArvCamera * camera ) {
+		unwatch();
+		std::lock_guard<std::mutex> lock( mutex );
+		device = camera ? arv_camera_get_device( camera ) : nullptr;
+		if (device) handler = g_signal_connect( device, "control-lost", G_CALLBACK( &Watchdog::onControlLost ), this );
+	}
+
+	void Watchdog::unwatch() {
+		std::lock_guard<std::mutex> lock( mutex );
+		if (device && handler) g_signal_handler_disconnect( device, handler );
+		device = nullptr;
+		handler = 0;
+	}
+
+	// on an Aravis thread (GigE heartbeat, USB3 transfer)
+
+	void Watchdog::onControlLost( ArvDevice * device, gpointer self ) {
+		Watchdog * watchdog = static_cast<Watchdog *>( self );
+		watchdog->controlLost = true;
+		watchdog->wake.notify_all();
+	}
+
+	void Watchdog::frameArrived() {
+		uint64_t now = Now();
+		lastFrame = now;
+		armed = true;
+		if (firstFrame.load( std::memory_order_relaxed ) == 0) {
+			uint64_t none = 0;
+			firstFrame.compare_exchange_strong( none, now );
+		}
+	}
+
+	void Watchdog::disarm() {
+		armed = false;
+	}
+
+	void Watchdog::setListener( Listener l ) {
+		std::lock_guard<std::mutex> lock( mutex );
+		listener = l;
+	}
+
+	bool Watchdog::isRecovering() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return recovering;
+	}
+
+	uint64_t Watchdog::getRecoveries() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return recoveries;
+	}
+
+	uint64_t Watchdog::getFailures() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return failures;
+	}
+
+	std::vector<RecoveryEvent> Watchdog::getHistory() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return std::vector<RecoveryEvent>( history.begin(), history.end() );
+	}
+
+	void Watchdog::report( const RecoveryEvent & event ) {
+
+		Listener l;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			history.push_back( event );
+			while (history.size() > 16) history.pop_front();
+			if (event.ok) recoveries += 1;
+			else failures += 1;
+			l = listener;
+		}
+
+		if (event.ok) ofLogNotice("ofxAravis") << "Watchdog: recovered, " << event.toJson().dump();
+		else ofLogError("ofxAravis") << "Watchdog: recovery failed, " << event.toJson().dump();
+		if (l) l( event );
+	}
+
+	void Watchdog::threadedFunction() {
+
+		std::unique_lock<std::mutex> lock( mutex );
+
+		while (running) {
+
+			wake.wait_for( lock, std::chrono::milliseconds( 50 ) );
+			if (!running) break;
+
+			uint64_t now = Now();
+			uint64_t timeout = uint64_t( settings.frameTimeout * 1e9 );
+			bool stalled = timeout > 0 && armed && now - lastFrame > timeout;
+			if (!controlLost && !stalled) continue;
+
+			// ------- REOPEN -------
+
+			RecoveryEvent event;
+			event.cause = controlLost ? RECOVERY_CONTROL_LOST : RECOVERY_FRAME_TIMEOUT;
+			ofLogWarning("ofxAravis") << "Watchdog: " << CauseToString( event.cause ) << ", reopening";
+
+			uint64_t detected = now;
+			bool streaming = armed; // a camera that wasn't delivering isn't expected to afterwards
+			recovering = true;
+			armed = false;
+			firstFrame = 0;
+
+			bool ok = false;
+			while (running && !ok && (settings.maxAttempts <= 0 || event.attempts < settings.maxAttempts)) {
+				if (event.attempts > 0) {
+					wake.wait_for( lock, std::chrono::duration<double>( settings.retryInterval ), [this] { return !running; } );
+					if (!running) break;
+				}
+				event.attempts += 1;
+				lock.unlock();
+				ok = recover && recover( event.attempts );
+				lock.lock();
+			}
+
+			// the old device may have kept signalling while it was replaced
+			controlLost = false;
+
+			if (!ok) {
+				recovering = false;
+				event.message = running ? "gave up after " + ofToString( event.attempts ) + " attempts" : "stopped";
+				lock.unlock();
+				report( event );
+				lock.lock();
+				continue;
+			}
+
+			event.reopenMs = (Now() - detected) / 1e6;
+
+			// ------- FIRST FRAME -------
+
+			// frameArrived() stamps it, so polling here doesn't add to the measurement
+			double wait = settings.frameTimeout > 0 ? settings.frameTimeout : 10;
+			uint64_t deadline = Now() + uint64_t( wait * 1e9 );
+			while (streaming && running && !controlLost && firstFrame == 0 && Now() < deadline) {
+				wake.wait_for( lock, std::chrono::milliseconds( 1 ) );
+			}
+
+			uint64_t first = firstFrame;
+			recovering = false;
+
+			if (!streaming) {
+				event.ok = true;
+			} else if (first != 0) {
+				event.ok = true;
+				event.firstFrameMs = (first - detected) / 1e6;
+			} else {
+				event.message = "no frame after reopening";
+				// a frame timeout tries again on the next pass
+				lastFrame = Now() - timeout;
+				armed = timeout > 0;
+			}
+
+			lock.unlock();
+			report( event );
+			lock.lock();
+		}
+	}
+
+	ofJson RecoveryEvent::toJson() const {
+		ofJson json;
+		json["cause"] = CauseToString( cause );
+		json["ok"] = ok;
+		json["attempts"] = attempts;
+		json["reopenMs"] = reopenMs;
+		json["firstFrameMs"] = firstFrameMs;
+		if (!message.empty()) json["message"] = message;
+		return json;
+	}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <arv.h>
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+namespace ofxAravis {
+
+    // ------- WATCHDOG -------
+
+    // Notices a camera that stopped working and has its owner reopen it. Two signs: the
+    // device's control-lost signal (GigE heartbeat missed, USB3 transfer errors), and no frame
+    // for frameTimeout seconds after frames had been arriving. recover() runs on the watchdog
+    // thread and retries every retryInterval until it succeeds or maxAttempts is used up; the
+    // recovery is reported once the first frame after it arrives (or doesn't), or right away
+    // when no frames were arriving before it.
+    //
+    // Owners call frameArrived() from the stream thread, disarm() whenever they stop streaming
+    // on purpose and watch() after every open. Triggered cameras that may sit idle for longer
+    // than frameTimeout should set it to 0 and rely on control-lost.
+
+    struct WatchdogSettings {
+        double frameTimeout = 2; // s without frames while armed, 0 = control-lost only
+        double retryInterval = 0.5; // s between reopen attempts
+        int maxAttempts = 0; // 0 = until stopped
+    };
+
+    enum RecoveryCause {
+        RECOVERY_CONTROL_LOST,
+        RECOVERY_FRAME_TIMEOUT
+    };
+
+    struct RecoveryEvent {
+        RecoveryCause cause = RECOVERY_CONTROL_LOST;
+        bool ok = false; // reopened and delivering frames again
+        int attempts = 0;
+        double reopenMs = -1; // detection to recover() returning true
+        double firstFrameMs = -1; // detection to the first frame after it, -1 = none came
+        std::string message;
+
+        ofJson toJson() const;
+    };
+
+    class Watchdog {
+        public:
+            // reopen, reapply and restart the stream; attempt counts from 1 per recovery, so what to
+            // restore (polling, streaming) is captured on the first, later ones find it torn down
+            using Recover = std::function<bool( int attempt )>;
+            using Listener = std::function<void(const RecoveryEvent & event)>;
+
+            ~Watchdog();
+
+            void start( WatchdogSettings settings, Recover recover );
+            void stop(); // disconnects the signal
+            bool isRunning();
+
+            void watch( ArvCamera * camera ); // after every (re)open, before the camera can go
+            void unwatch(); // before the camera is released
+            void frameArrived(); // stream thread, arms the frame timeout
+            void disarm(); // streaming stopped on purpose
+
+            void setListener( Listener listener ); // on the watchdog thread
+            bool isRecovering();
+            uint64_t getRecoveries(); // succeeded
+            uint64_t getFailures();
+            std::vector<RecoveryEvent> getHistory(); // the last 16, oldest first
+
+        private:
+            static void onControlLost( ArvDevice * device, gpointer self );
+            void report( const RecoveryEvent & event );
+            void threadedFunction();
+
+            WatchdogSettings settings;
+            Recover recover;
+            Listener listener;
+
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::thread thread;
+            bool running = false;
+            bool recovering = false;
+
+            ArvDevice * device = nullptr;
+            gulong handler = 0;
+
+            std::atomic<bool> armed { false };
+            std::atomic<bool> controlLost { false };
+            std::atomic<uint64_t> lastFrame { 0 }; // steady clock ns
+            std::atomic<uint64_t> firstFrame { 0 }; // after a detection, 0 until one arrives
+
+            std::deque<RecoveryEvent> history;
+            uint64_t recoveries = 0;
+            uint64_t failures = 0;
+    };
+
+}
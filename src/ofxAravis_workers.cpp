@@ -0,0 +1,248 @@
+#include "ofxAravis_workers.h"
+
+namespace ofxAravis {
+
+	// ------- WORKER POOL -------
+
+	WorkerPool::~WorkerPool() {
+		stop();
+	}
+
+	void WorkerPool::start( int workers ) {
+
+		stop();
+
+		std::lock_guard<std::mutex> lock( mutex );
+		running = true;
+		if (workers < 1) workers = 1;
+		for (int i = 0; i < workers; i++) {
+			threads.emplace_back( &WorkerPool::threadedFunction, this );
+		}
+	}
+
+	void WorkerPool::stop() {
+
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (!running) return;
+			running = false;
+		}
+
+		// the threads empty the queue before leaving, ConversionPools wait on what they posted
+		ready.notify_all();
+		for (auto & thread : threads) thread.join();
+		threads.clear();
+	}
+
+	bool WorkerPool::isRunning() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return running;
+	}
+
+	int WorkerPool::getWorkerCount() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return int( threads.size() );
+	}
+
+	bool WorkerPool::post( Task task ) {
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if (!running) return false;
+			tasks.push_back( std::move( task ) );
+		}
+		ready.notify_one();
+		return true;
+	}
+
+	size_t WorkerPool::getPending() {
+		std::lock_guard<std::mutex> lock( mutex );
+		return tasks.size();
+	}
+
+	void WorkerPool::threadedFunction() {
+
+		while (true) {
+
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock( mutex );
+				ready.wait( lock, [this] { return !tasks.empty() || !running; } );
+				if (tasks.empty()) return;
+				task = std::move( tasks.front() );
+				tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	// ------- CONVERSION POOL -------
+
+	ConversionPool::~ConversionPool() {
+		stop();
+	}
+
+	void ConversionPool::start( int workers, Convert c, Deliver d ) {
+
+		stop();
+
+		convert = c;
+		deliver = d;
+		nextSubmit = 0;
+		nextDeliver = 0;
+		reordered = 0;
+		running = true;
+
+		if (workers < 1) workers = 1;
+		for (int i = 0; i < workers; i++) {
+			threads.emplace_back( &ConversionPool::threadedFunction, this );
+		}
+	}
+
+	void ConversionPool::start( WorkerPool & pool, Convert c, Deliver d ) {
+
+		stop();
+
+		std::lock_guard<std::mutex> lock( inputMutex );
+		convert = c;
+		deliver = d;
+		nextSubmit = 0;
+		nextDeliver = 0;
+		reordered = 0;
+		shared = &pool;
+		running = true;
+	}
+
+	void ConversionPool::stop() {
+
+		{
+			std::lock_guard<std::mutex> lock( inputMutex );
+			if (!running) return;
+			running = false;
+		}
+
+		inputReady.notify_all();
+		for (auto & thread : threads) thread.join();
+		threads.clear();
+
+		// conversions already on the shared pool see running == false and drop their frame
+		std::unique_lock<std::mutex> lock( inputMutex );
+		idle.wait( lock, [this] { return inFlight == 0; } );
+		shared = nullptr;
+		input.clear();
+		std::lock_guard<std::mutex> order( orderMutex );
+		done.clear();
+	}
+
+	bool ConversionPool::isRunning() {
+		std::lock_guard<std::mutex> lock( inputMutex );
+		return running;
+	}
+
+	int ConversionPool::getWorkerCount() {
+		WorkerPool * pool;
+		{
+			std::lock_guard<std::mutex> lock( inputMutex );
+			pool = shared;
+		}
+		return pool ? pool->getWorkerCount() : int( threads.size() );
+	}
+
+	void ConversionPool::submit( FrameLease raw ) {
+
+		uint64_t sequence;
+		WorkerPool * pool;
+		{
+			std::lock_guard<std::mutex> lock( inputMutex );
+			if (!running) return;
+			if (!shared) {
+				input.emplace_back( nextSubmit++, std::move( raw ) );
+				pool = nullptr;
+			} else {
+				sequence = nextSubmit++;
+				inFlight += 1;
+				pool = shared;
+			}
+		}
+
+		if (!pool) {
+			inputReady.notify_one();
+			return;
+		}
+
+		// moved on into convert, so the camera buffer goes back before delivery like on our own threads
+		if (!pool->post( [this, sequence, raw]() mutable { run( sequence, std::move( raw ) ); } )) {
+			run( sequence, nullptr ); // pool stopped first, keep the sequence moving
+		}
+	}
+
+	void ConversionPool::run( uint64_t sequence, FrameLease raw ) {
+
+		if (isRunning()) complete( sequence, raw ? convert( std::move( raw ) ) : nullptr );
+
+		std::lock_guard<std::mutex> lock( inputMutex );
+		inFlight -= 1;
+		idle.notify_all();
+	}
+
+	size_t ConversionPool::getPending() {
+		std::lock_guard<std::mutex> lock( inputMutex );
+		std::lock_guard<std::mutex> order( orderMutex );
+		return size_t( nextSubmit - nextDeliver );
+	}
+
+	uint64_t ConversionPool::getReorderedCount() {
+		return reordered;
+	}
+
+	void ConversionPool::threadedFunction() {
+
+		while (true) {
+
+			uint64_t sequence;
+			FrameLease raw;
+			{
+				std::unique_lock<std::mutex> lock( inputMutex );
+				inputReady.wait( lock, [this] { return !input.empty() || !running; } );
+				if (!running) return;
+				sequence = input.front().first;
+				raw = std::move( input.front().second );
+				input.pop_front();
+			}
+
+			// convert drops the raw lease, so the camera buffer is back in the stream before delivery
+
+			complete( sequence, convert( std::move( raw ) ) );
+		}
+	}
+
+	void ConversionPool::complete( uint64_t sequence, FrameLease frame ) {
+
+		std::unique_lock<std::mutex> lock( orderMutex );
+
+		if (sequence != nextDeliver) reordered += 1;
+		done.emplace( sequence, std::move( frame ) );
+
+		// whichever worker gets here first delivers every consecutive frame that is ready,
+		// the others just leave their result behind
+
+		if (delivering) return;
+		delivering = true;
+
+		while (true) {
+			auto it = done.find( nextDeliver );
+			if (it == done.end()) break;
+
+			FrameLease ready = std::move( it->second );
+			done.erase( it );
+			nextDeliver += 1;
+
+			lock.unlock();
+			if (ready) deliver( std::move( ready ) );
+			lock.lock();
+		}
+
+		delivering = false;
+	}
+
+}
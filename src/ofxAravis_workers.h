@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ofxAravis_frame.h"
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+namespace ofxAravis {
+
+    // ------- WORKER POOL -------
+
+    // A fixed set of threads running tasks in the order they were posted. Several cameras'
+    // ConversionPools can share one (see CameraGroup), so the thread count stays the same
+    // however many cameras are open.
+
+    class WorkerPool {
+        public:
+            using Task = std::function<void()>;
+
+            ~WorkerPool();
+
+            void start( int workers );
+            void stop(); // runs what was already posted, then joins
+            bool isRunning();
+            int getWorkerCount();
+
+            bool post( Task task ); // false when not running
+            size_t getPending(); // posted but not yet started
+
+        private:
+            void threadedFunction();
+
+            std::vector<std::thread> threads;
+            std::mutex mutex;
+            std::condition_variable ready;
+            std::deque<Task> tasks;
+            bool running = false;
+    };
+
+    // ------- CONVERSION POOL -------
+
+    // Converts several frames at once on N worker threads and hands the results
+    // to deliver() one at a time, in the order they were submitted. Frames are submitted
+    // in stream order, which is frame id order, so gaps from dropped frames never stall delivery.
+    // With a shared WorkerPool the conversions run on its threads instead of our own.
+
+    class ConversionPool {
+        public:
+            using Convert = std::function<FrameLease(FrameLease raw)>; // release raw as soon as it is converted, return nullptr to skip
+            using Deliver = std::function<void(FrameLease frame)>;
+
+            ~ConversionPool();
+
+            void start( int workers, Convert convert, Deliver deliver );
+            void start( WorkerPool & pool, Convert convert, Deliver deliver ); // pool must outlive stop()
+            void stop();
+            bool isRunning();
+            int getWorkerCount();
+
+            void submit( FrameLease raw );
+
+            size_t getPending(); // submitted but not yet delivered
+            uint64_t getReorderedCount(); // frames that finished before an earlier one and had to wait
+
+        private:
+            void threadedFunction();
+            void run( uint64_t sequence, FrameLease raw ); // one conversion on a shared pool thread
+            void complete( uint64_t sequence, FrameLease frame );
+
+            Convert convert;
+            Deliver deliver;
+
+            std::vector<std::thread> threads;
+            WorkerPool * shared = nullptr;
+            int inFlight = 0; // posted to the shared pool and not yet finished
+            std::condition_variable idle;
+            std::mutex inputMutex;
+            std::condition_variable inputReady;
+            std::deque<std::pair<uint64_t, FrameLease>> input;
+            uint64_t nextSubmit = 0;
+            bool running = false;
+
+            std::mutex orderMutex;
+            std::map<uint64_t, FrameLease> done;
+            uint64_t nextDeliver = 0;
+            bool delivering = false;
+            std::atomic<uint64_t> reordered { 0 };
+    };
+
+}
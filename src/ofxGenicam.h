@@ -14,6 +14,24 @@
 #include <atomic>
 #include <chrono>
 
+#include "ofxAravis_discovery.h"
+#include "ofxAravis_frame.h"
+#include "ofxAravis_acquisition.h"
+#include "ofxAravis_buffers.h"
+#include "ofxAravis_queue.h"
+#include "ofxAravis_convert.h"
+#include "ofxAravis_stats.h"
+#include "ofxAravis_features.h"
+#include "ofxAravis_poller.h"
+#include "ofxAravis_control.h"
+#include "ofxAravis_registers.h"
+#include "ofxAravis_clock.h"
+#include "ofxAravis_watchdog.h"
+#include "ofxAravis_apply.h"
+#include "ofxAravis_profile.h"
+#include "ofxAravis_tree.h"
+#include "ofxAravis_cache.h"
+
 namespace ofxGenicam {
 
     // ====== GENERAL ======
@@ -30,28 +48,48 @@ namespace ofxGenicam {
             using ErrorCallback = std::function<void(std::string origin, std::string message)>;
 
             void setBufferCallback( BufferCallback callback );
+            void setFrameCallback( ofxAravis::FrameCallback callback ); // zero-copy, the buffer is returned when the lease is released
             void setErrorCallback( ErrorCallback callback );
 
             BufferCallback bufferCallback;
+            ofxAravis::FrameCallback frameCallback;
             ErrorCallback errorCallback;
 
             // ====== SETUP ======
 
             Camera();
-            bool open( int index = 0 );
+            void setGenicamCacheSettings( ofxAravis::GenicamCacheSettings settings ); // call before the first getFeatureTree
+            bool open( int index = 0 ); // index into the cached device list, see DiscoveryService
+            bool open( const std::string & name ); // serial number, MAC, address or id
             ~Camera();
 
             void onAppExit(ofEventArgs& args);
 
             // ====== STREAM ======
 
-            bool start( int numberOfBuffers = 2 ); // less = faster, more = less glitchy
+            void setAcquisitionSettings( ofxAravis::AcquisitionSettings settings ); // call before start
+            void setBufferPoolSettings( ofxAravis::BufferPoolSettings settings ); // call before start
+            void setQueueSettings( ofxAravis::QueueSettings settings ); // call before start
+            ofxAravis::QueueStats getQueueStats();
+
+            uint64_t getDroppedFrames(); // frame ids missing from the stream since start
+            uint64_t getReceivedFrames();
+            guint64 getLastFrameId();
+            ofxAravis::ClockModel & getClockModel(); // camera clock against the host, fitted from every frame
+            guint64 toHostTime( guint64 deviceTimestamp ); // Frame::timestamp on the Frame::systemTimestamp clock
+            ofxAravis::StatsSnapshot getStats(); // fps, frame intervals, unpack, callback and latency percentiles, buffer statuses
+
+            // numberOfBuffers overrides the pool count, 0 keeps setBufferPoolSettings': fewer buffers =
+            // less memory and latency, more = more headroom before frames drop when callbacks run slow
+            bool start( int numberOfBuffers = 0 );
             bool stop();
         
             // ====== FEATURES ======
         
             std::string getGenicamXML();
-            ofJson listAllFeatures( bool print = true );
+            ofJson listAllFeatures( bool print = true ); // nested, with values
+            // flat and indexed; structure only unless options.values, see FeatureTree
+            ofxAravis::FeatureTree getFeatureTree( const ofxAravis::FeatureTreeOptions & options = ofxAravis::FeatureTreeOptions() );
         
             bool setStr( std::string key, std::string value );
             std::string getStr( std::string key );
@@ -59,19 +97,77 @@ namespace ofxGenicam {
             bool setBool( std::string key, bool value );
             bool getBool( std::string key );
         
-            bool setInt( std::string key, int value );
-            int getInt( std::string key );
+            bool setInt( std::string key, gint64 value );
+            gint64 getInt( std::string key );
             
-            bool setFloat( std::string key, float value );
-            float getFloat( std::string key );
+            bool setFloat( std::string key, double value );
+            double getFloat( std::string key );
+
+            // any type at full precision, range checked before sending, see FeatureCache::set
+            template<typename T> bool set( std::string key, const T & value, bool clamp = true ) {
+                GError * err = nullptr;
+                bool ok = features.set<T>( key, value, &err, clamp );
+                if (ok) registers.invalidate( key );
+                return !handleError( err, "set " + key ) && ok;
+            }
+            template<typename T> T get( std::string key ) {
+                GError * err = nullptr;
+                T value = features.get<T>( key, &err );
+                handleError( err, "get " + key );
+                return value;
+            }
         
             bool executeCommand( std::string command );
+
+            // callback on the poller thread whenever the feature's value changes, all subscriptions
+            // are read in one background cycle under the control lock
+            int subscribe( std::string key, double interval, ofxAravis::FeaturePoller::Callback callback, double tolerance = 0 );
+            void unsubscribe( int id );
+            ofxAravis::FeaturePoller & getPoller();
+
+            // same calls on the control worker thread, see ControlChannel; repeated writes to a
+            // feature are merged, so these can be called every frame from a slider
+            std::future<ofxAravis::ControlResult> setAsync( std::string key, ofJson value, ofxAravis::ControlCallback callback = ofxAravis::ControlCallback() );
+            std::future<ofxAravis::ControlResult> getAsync( std::string key, ofxAravis::ControlCallback callback = ofxAravis::ControlCallback() );
+            std::future<ofxAravis::ControlResult> executeCommandAsync( std::string command, ofxAravis::ControlCallback callback = ofxAravis::ControlCallback() );
+
+            // opt-in direct register writes for features set every frame, see RegisterFastPath;
+            // setFast falls back to set<double> when the feature didn't map
+            bool enableFastPath( std::string key );
+            void disableFastPath( std::string key );
+            bool setFast( std::string key, double value );
+            ofxAravis::RegisterFastPath & getRegisterFastPath();
+
+            // many features at once in dependency order, restarts the stream if a locked one changes
+            ofxAravis::ApplyResult applyFeatures( const ofJson & values, bool rollback = false );
+
+            // listAllFeatures() plus every selector entry to and from disk, loading writes only what differs, see ProfileToValues
+            bool saveProfile( std::string path );
+            ofxAravis::ApplyResult loadProfile( std::string path, bool rollback = false );
+            ofxAravis::ApplyResult applyProfile( const ofJson & profile, bool rollback = false );
+
+            // reopens the same device when control is lost or frames stop and restarts the
+            // stream with the configuration captured when enabled, see Watchdog; after open
+            void enableWatchdog( ofxAravis::WatchdogSettings settings = ofxAravis::WatchdogSettings() );
+            void disableWatchdog();
+            void captureConfiguration();
+            ofxAravis::Watchdog & getWatchdog();
             std::function<void(ArvStream*)> bufferCallbackWrapper;
 
         private:
         
         
-            ArvCamera * camera;
+            ArvCamera * camera = nullptr;
+            ofxAravis::FeatureCache features;
+            ofxAravis::FeaturePoller poller;
+            ofxAravis::ControlChannel controlChannel;
+            ofxAravis::RegisterFastPath registers;
+            ofxAravis::Watchdog watchdog;
+            ofJson recoveryConfiguration; // under the control lock
+            bool recoveryPolling = false; // state when the recovery in progress began, see reopen
+            bool recoveryStreaming = false;
+            std::string deviceId;
+            bool reopen( int attempt );
             
             // ====== ERRORS ======
             
@@ -79,7 +175,7 @@ namespace ofxGenicam {
 
             // ====== STREAM ======
 
-            bool isStreaming = false;
+            std::atomic<bool> isStreaming { false };
 
             ArvStream * stream = nullptr;
             using Clock = std::chrono::high_resolution_clock;
@@ -93,11 +189,22 @@ namespace ofxGenicam {
 
             std::string pixelFormat;
 
-            static void onNewBuffer(ArvStream * stream, Camera * aravis);
+            void onNewBuffer(ArvStream * stream, ArvBuffer * buffer);
+            void processFrame(ofxAravis::FrameLease lease);
+
+            ofxAravis::Acquisition acquisition;
+            ofxAravis::AcquisitionSettings acquisitionSettings;
+            ofxAravis::BufferPool bufferPool;
+            ofxAravis::BufferPoolSettings bufferPoolSettings { 2 };
+            ofxAravis::FrameQueue frameQueue;
+            ofxAravis::QueueSettings queueSettings;
+            ofxAravis::FramePool unpackPool;
+            ofxAravis::FrameIdTracker frameIds;
+            ofxAravis::ClockModel clock;
 
             // ====== STATS ======
 
-            ofJson stats;
+            ofxAravis::StatsCollector stats;
 
             // ====== UTILITIES ======
 
@@ -106,8 +213,8 @@ namespace ofxGenicam {
 
             // ====== FEATURES ======
 
-            void loopThroughFeatures( ofJson & features, ArvGc * genicam, const char * feature, int level );
-            void processFeatureNode( ofJson & entry, ArvGcFeatureNode * node, int level );
+            ofxAravis::FeatureTree featureTree; // structure only, from the cache or built on first use
+            ofxAravis::GenicamCache genicamCache;
 
     };
     
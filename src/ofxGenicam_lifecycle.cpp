@@ -6,23 +6,23 @@ namespace ofxGenicam {
 
 	ofJson listDevices(bool print) {
 
-		ofJson devices;
+		ofJson devices = ofJson::array();
 
-		arv_update_device_list();
+		// cached while younger than the TTL, see DiscoveryService
+		for (auto & found : ofxAravis::GetDiscoveryService().getDevices()) {
 
-		for (int i = 0; i < arv_get_n_devices(); i++) {
+			ofJson device;
 
-			devices[i] = ofJson::array();
+			device["id"] = found.id;
+			device["physical_id"] = found.physical_id;
+			device["address"] = found.address;
+			device["vendor"] = found.vendor;
+			device["manufacturer_info"] = found.manufacturer_info;
+			device["model"] = found.model;
+			device["serial_nbr"] = found.serial_nbr;
+			device["protocol"] = found.protocol;
 
-			devices[i]["id"] = arv_get_device_id(i);
-			devices[i]["physical_id"] = arv_get_device_physical_id(i);
-			devices[i]["address"] = arv_get_device_address(i);
-			devices[i]["vendor"] = arv_get_device_vendor(i);
-			devices[i]["manufacturer_info"] = arv_get_device_manufacturer_info(i);
-			devices[i]["model"] = arv_get_device_model(i);
-			devices[i]["serial_nbr"] = arv_get_device_serial_nbr(i);
-			devices[i]["protocol"] = arv_get_device_protocol(i);
-			
+			devices.push_back( device );
 		}
 
 		if (print) ofLogNotice("listDevices") << devices.dump(4);
@@ -36,6 +36,10 @@ namespace ofxGenicam {
 		bufferCallback = callback;
 	}
 
+	void Camera::setFrameCallback(ofxAravis::FrameCallback callback) {
+		frameCallback = callback;
+	}
+
 	void Camera::setErrorCallback(ErrorCallback callback) {
 		errorCallback = callback;
 	}
@@ -47,14 +51,54 @@ namespace ofxGenicam {
 
 	bool Camera::open( int index ) {
 
+		std::vector<ofxAravis::Device> devices = ofxAravis::GetDiscoveryService().getDevices();
+		if (index < 0 || index >= int( devices.size() )) {
+			ofLogError("Camera") << "no camera to open at " << index;
+			return false;
+		}
+		return open( devices[index].id );
+	}
+
+	bool Camera::open( const std::string & name ) {
+
+		// serial numbers and MACs resolve from the device list, anything else (GigE user ids) Aravis resolves
+		ofxAravis::Device device;
+		std::string id = ofxAravis::GetDiscoveryService().find( name, device ) ? device.id : name;
+		deviceId = id;
+
 		ofAddListener(ofEvents().exit, this, &Camera::onAppExit );
 		GError* error = nullptr;
-		camera = arv_camera_new( arv_get_device_id(index), &error );
-		return !handleError(error, "Camera");
+		ArvCamera * opened = nullptr;
+		{
+			std::shared_lock<std::shared_mutex> list( ofxAravis::GetDeviceListMutex() );
+			opened = arv_camera_new( id.c_str(), &error );
+		}
+		{
+			std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+			camera = opened;
+			features.setCamera( camera );
+			registers.setCamera( camera, &features );
+			featureTree.clear();
+		}
+		clock.reset();
+		if (handleError(error, "Camera")) return false;
+
+		controlChannel.setFeatures( &features );
+		controlChannel.start();
+		return camera != nullptr;
+	}
+
+	void Camera::setGenicamCacheSettings( ofxAravis::GenicamCacheSettings settings ) {
+		genicamCache.setSettings( settings );
 	}
 
 	Camera::~Camera() {
 
+		// subscriptions and queued control requests go through the camera, they stop before it goes
+		watchdog.stop();
+		poller.stop();
+		controlChannel.stop();
+
 		if (isStreaming) {
 			GError *err = nullptr;
 			arv_camera_abort_acquisition( camera, &err );
@@ -62,12 +106,109 @@ namespace ofxGenicam {
 			stop();
 		}
 
-		g_object_unref(stream);
-		g_object_unref(camera);
+		if (stream) g_object_unref(stream);
+		registers.setCamera( nullptr, nullptr );
+		features.setCamera( nullptr );
+		featureTree.clear();
+		if (camera) g_object_unref(camera);
 
 		ofRemoveListener(ofEvents().exit, this, &Camera::onAppExit);
 	}
 
+	// ====== RECOVERY ======
+
+	void Camera::enableWatchdog( ofxAravis::WatchdogSettings settings ) {
+		captureConfiguration();
+		// started first, a watchdog that was already running drops its signal on the way
+		watchdog.start( settings, [this]( int attempt ) { return reopen( attempt ); } );
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (camera) watchdog.watch( camera );
+	}
+
+	void Camera::disableWatchdog() {
+		watchdog.stop();
+	}
+
+	void Camera::captureConfiguration() {
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return;
+		recoveryConfiguration = ofxAravis::ProfileToValues( listAllFeatures( false ) );
+	}
+
+	ofxAravis::Watchdog & Camera::getWatchdog() {
+		return watchdog;
+	}
+
+	// on the watchdog thread, same steps as open() and start() without the rescan. The old
+	// camera goes and the new one comes under the control lock, opening runs outside it and
+	// every call meanwhile finds no camera
+
+	bool Camera::reopen( int attempt ) {
+
+		// later attempts find it all torn down by the first
+		if (attempt == 1) {
+			recoveryPolling = poller.isRunning();
+			recoveryStreaming = isStreaming;
+		}
+
+		poller.stop();
+		controlChannel.stop();
+		watchdog.unwatch();
+
+		std::vector<std::string> fast = registers.getFeatures();
+
+		// joins the frame threads before taking the lock, a frame callback may be setting a feature
+		if (isStreaming) stop();
+
+		{
+			std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+			if (stream) g_object_unref( stream );
+			stream = nullptr;
+			registers.setCamera( nullptr, nullptr );
+			features.setCamera( nullptr );
+			featureTree.clear();
+			if (camera) g_object_unref( camera );
+			camera = nullptr;
+		}
+
+		GError * error = nullptr;
+		ArvCamera * reopened = nullptr;
+		{
+			std::shared_lock<std::shared_mutex> list( ofxAravis::GetDeviceListMutex() );
+			reopened = arv_camera_new( deviceId.c_str(), &error );
+		}
+		if (handleError( error, "reopen" ) || !reopened) {
+			if (reopened) g_object_unref( reopened );
+			return false;
+		}
+
+		bool ok = true;
+		{
+			std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+
+			camera = reopened;
+			features.setCamera( camera );
+			registers.setCamera( camera, &features );
+
+			ofxAravis::ApplyResult result = ofxAravis::ApplyFeatures( features, recoveryConfiguration );
+			if (!result.ok()) ofLogWarning("Camera") << "reopen: " << result.failed << " features not restored";
+			for (auto & key : fast) registers.enable( key );
+
+			// only what was streaming before, allocate() keeps the arena when it still fits
+			if (recoveryStreaming) ok = start();
+
+			watchdog.watch( camera );
+		}
+
+		controlChannel.setFeatures( &features );
+		controlChannel.start();
+		if (recoveryPolling) {
+			poller.setCycleMutex( &features.getControlMutex() );
+			poller.start();
+		}
+		return ok;
+	}
+
 	void Camera::onAppExit(ofEventArgs& args) {
 		stop();
 	}
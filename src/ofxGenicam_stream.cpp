@@ -5,8 +5,58 @@ namespace ofxGenicam {
 
 	// ====== STREAM ======
 
+	void Camera::setAcquisitionSettings( ofxAravis::AcquisitionSettings settings ) {
+		acquisitionSettings = settings;
+	}
+
+	void Camera::setBufferPoolSettings( ofxAravis::BufferPoolSettings settings ) {
+		bufferPoolSettings = settings;
+	}
+
+	void Camera::setQueueSettings( ofxAravis::QueueSettings settings ) {
+		queueSettings = settings;
+	}
+
+	ofxAravis::QueueStats Camera::getQueueStats() {
+		return frameQueue.getStats();
+	}
+
+	uint64_t Camera::getDroppedFrames() {
+		return frameIds.getDropped();
+	}
+
+	uint64_t Camera::getReceivedFrames() {
+		return frameIds.getReceived();
+	}
+
+	guint64 Camera::getLastFrameId() {
+		return frameIds.getLastFrameId();
+	}
+
+	ofxAravis::ClockModel & Camera::getClockModel() {
+		return clock;
+	}
+
+	guint64 Camera::toHostTime( guint64 deviceTimestamp ) {
+		return clock.toHost( deviceTimestamp );
+	}
+
+	ofxAravis::StatsSnapshot Camera::getStats() {
+		ofxAravis::StatsSnapshot snapshot = stats.getSnapshot();
+		snapshot.dropped = frameIds.getDropped();
+		return snapshot;
+	}
+
 	bool Camera::start( int numberOfBuffers ) {
 
+		// the old stream's buffers point into the arena, so it goes before the arena can be remapped;
+		// its threads are joined before the control lock, a frame callback may be setting a feature
+
+		if (isStreaming) stop();
+
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return false;
+
 		GError * err = nullptr;
 
 		// PIXEL FORMAT
@@ -19,28 +69,38 @@ namespace ofxGenicam {
 		auto payload = arv_camera_get_payload(camera, &err);
 		if (handleError( err, "arv_camera_get_payload" )) return false;
 
+		// BUFFERS
+
+		if (stream) g_object_unref( stream );
+		stream = nullptr;
+
+		if (numberOfBuffers > 0) bufferPoolSettings.count = numberOfBuffers;
+		if (!bufferPool.allocate( payload, bufferPoolSettings )) return false;
+
 		// STREAM
 
 		stream = arv_camera_create_stream(camera, nullptr, nullptr, &err);
 		if (handleError( err, "arv_camera_create_stream" ) || !stream) {
-			g_object_unref( stream );
+			if (stream) g_object_unref( stream );
+			stream = nullptr;
 			return false;
 		}
 
-		// BUFFERS
-
-		for (int i = 0; i < numberOfBuffers; i++) {
-			arv_stream_push_buffer(stream, arv_buffer_new(payload, nullptr));
-		}
+		bufferPool.push( stream );
 			
 		arv_camera_start_acquisition(camera, &err);
 		if (handleError( err, "arv_camera_start_acquisition" )) {
 			g_object_unref( stream );
+			stream = nullptr;
 			return false;
 		}
 		
-		g_signal_connect(stream, "new-buffer", G_CALLBACK(onNewBuffer), this);
-		arv_stream_set_emit_signals(stream, true);
+		registers.invalidate(); // TLParamsLocked follows acquisition
+		frameIds.reset();
+		stats.reset();
+		if (queueSettings.enabled) frameQueue.start( queueSettings, [this]( ofxAravis::FrameLease lease ) { processFrame( std::move( lease ) ); } );
+		acquisition.start( stream, acquisitionSettings, [this]( ArvStream * s, ArvBuffer * b ) { onNewBuffer( s, b ); } );
+		isStreaming = true;
 
         ofLog() << "STARTING";
 		return true;
@@ -48,60 +108,114 @@ namespace ofxGenicam {
 
 	bool Camera::stop() {
 
-		arv_stream_set_emit_signals(stream, false);
+		watchdog.disarm();
+		// joined before the control lock, a frame callback may be setting a feature
+		acquisition.stop();
+		frameQueue.stop();
+		isStreaming = false;
+		std::lock_guard<std::recursive_mutex> control( features.getControlMutex() );
+		if (!camera) return false;
 		GError * err = nullptr;
 		arv_camera_stop_acquisition(camera, &err);
+		registers.invalidate();
 		return !handleError( err, "arv_camera_stop_acquisition" );
 		
 	}
 
 	// ====== STREAM ======
 
-	void Camera::onNewBuffer(ArvStream* stream, Camera * instance) {
+	void Camera::onNewBuffer(ArvStream* stream, ArvBuffer * buffer) {
 
-		ArvBuffer * buffer = arv_stream_try_pop_buffer(stream);
-		if (buffer == nullptr) {
-			ofLogError("onNewBuffer") << "buffer is nullptr";
+		ArvBufferStatus status = arv_buffer_get_status(buffer);
+		stats.bufferStatus( status );
+		if (status != ARV_BUFFER_STATUS_SUCCESS) {
+			ofLogError("onNewBuffer") << "buffer status:" << status;
+			arv_stream_push_buffer(stream, buffer);
 			return;
 		}
 
-		int status = arv_buffer_get_status(buffer);
-		if (status != ARV_BUFFER_STATUS_SUCCESS) {
-			ofLogError("onNewBuffer") << "buffer status:" << status;
+		if (arv_buffer_get_data(buffer, nullptr) == nullptr) {
+			ofLogError("onNewBuffer") << "buffer data is nullptr";
 			arv_stream_push_buffer(stream, buffer);
 			return;
 		}
 
-		auto width = arv_buffer_get_image_width(buffer);
-		auto height = arv_buffer_get_image_height(buffer);
-        ArvPixelFormat format = arv_buffer_get_image_pixel_format(buffer);
+		stats.frameArrived();
 
-		uint32_t bitsPerPixel = ARV_PIXEL_FORMAT_BIT_PER_PIXEL(format);
-        
-        const void* data = arv_buffer_get_data(buffer, nullptr);
+		// leased frames go back to the stream when the last consumer releases them
 
-		if (data == nullptr) {
-			ofLogError("onNewBuffer") << "buffer data is nullptr";
-			arv_stream_push_buffer(stream, buffer);
+		ofxAravis::FrameLease lease = ofxAravis::LeaseBuffer( stream, buffer );
+
+		// failed buffers were pushed back above, so they show up here as gaps
+
+		uint64_t missing = frameIds.update( lease->frameId );
+		clock.add( *lease );
+		watchdog.frameArrived();
+		if (missing > 0) ofLogVerbose("onNewBuffer") << "dropped " << missing << " frames before frame " << lease->frameId;
+
+		if (queueSettings.enabled) {
+			frameQueue.push( std::move( lease ) );
+		} else {
+			processFrame( std::move( lease ) );
+		}
+	}
+
+	void Camera::processFrame( ofxAravis::FrameLease lease ) {
+
+		using ofxAravis::StatsCollector;
+
+		guint64 now = ofxAravis::HostTimestamp();
+		if (lease->systemTimestamp > 0 && now > lease->systemTimestamp) stats.record( ofxAravis::METRIC_LATENCY, now - lease->systemTimestamp );
+
+		uint64_t start = StatsCollector::Now();
+		uint64_t callbackTime = 0;
+
+		if (frameCallback) {
+			frameCallback( lease );
+			callbackTime = StatsCollector::Now() - start;
+		}
+		if (!bufferCallback) {
+			if (frameCallback) stats.record( ofxAravis::METRIC_CALLBACK, callbackTime );
 			return;
 		}
 
+		int width = lease->width;
+		int height = lease->height;
+		uint32_t bitsPerPixel = ARV_PIXEL_FORMAT_BIT_PER_PIXEL(lease->pixelFormat);
+		void * data = lease->data;
+
+		// packed formats (Mono12p, Mono12Packed...) are unpacked to LSB aligned 16-bit samples first
+
+		const ofxAravis::PixelFormatInfo * info = ofxAravis::GetPixelFormatInfo( lease->pixelFormat );
+		std::shared_ptr<ofxAravis::Frame> unpacked;
+		if (info && info->packing != ofxAravis::PACKING_NONE) {
+			uint64_t unpackStart = StatsCollector::Now();
+			unpacked = unpackPool.acquire( size_t( width ) * height * 2 );
+			if (!ofxAravis::Unpack16( *lease, reinterpret_cast<uint16_t *>( unpacked->data ) )) {
+				ofLogError("onNewBuffer") << "incomplete packed frame: " << info->name;
+				return;
+			}
+			data = unpacked->data;
+			bitsPerPixel = 16;
+			stats.record( ofxAravis::METRIC_CONVERSION, StatsCollector::Now() - unpackStart );
+		}
+
+		start = StatsCollector::Now();
+
         if (bitsPerPixel == 8) {
-            auto* rawPixels = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(data));
-            instance->bufferCallback(rawPixels, width, height, bitsPerPixel, instance->pixelFormat);
+            auto* rawPixels = reinterpret_cast<uint8_t*>(data);
+            bufferCallback(rawPixels, width, height, bitsPerPixel, pixelFormat);
         } else if (bitsPerPixel >= 12 && bitsPerPixel < 32) {
-            auto* rawPixels = const_cast<uint16_t*>(reinterpret_cast<const uint16_t*>(data));
-            instance->bufferCallback(rawPixels, width, height, bitsPerPixel, instance->pixelFormat);
+            auto* rawPixels = reinterpret_cast<uint16_t*>(data);
+            bufferCallback(rawPixels, width, height, bitsPerPixel, pixelFormat);
         } else if (bitsPerPixel == 32) {
-            auto* rawPixels = const_cast<uint32_t*>(reinterpret_cast<const uint32_t*>(data));
-            instance->bufferCallback(rawPixels, width, height, bitsPerPixel, instance->pixelFormat);
+            auto* rawPixels = reinterpret_cast<uint32_t*>(data);
+            bufferCallback(rawPixels, width, height, bitsPerPixel, pixelFormat);
         } else {
             ofLogError("onNewBuffer") << "unsupported bits per pixel: " << bitsPerPixel;
         }
 
-		arv_stream_push_buffer(stream, buffer);
+		stats.record( ofxAravis::METRIC_CALLBACK, callbackTime + StatsCollector::Now() - start );
 	}
 
-
-
 }